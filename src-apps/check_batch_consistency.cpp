@@ -0,0 +1,97 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#include "DarkHelp.hpp"
+
+
+/* Compare the results from predict_batch() against the results from calling predict() on each image.  Returns the
+ * number of images where the results are not the same.
+ */
+size_t compare_results(const DarkHelp::EDriver driver, const std::string & cfg, const std::string & names, const std::string & weights, const cv::Mat & mat, const int batch_size)
+{
+	DarkHelp::Config config(cfg, weights, names, true, driver);
+	config.batch_size = batch_size;
+	DarkHelp::NN nn(config);
+
+	DarkHelp::PredictionResults single = nn.predict(mat);
+	std::sort(single.begin(), single.end(), [](const auto & lhs, const auto & rhs) { return lhs.rect.x < rhs.rect.x or (lhs.rect.x == rhs.rect.x and lhs.rect.y < rhs.rect.y); });
+
+	const std::vector<cv::Mat> images(batch_size, mat);
+	auto batch = nn.predict_batch(images);
+
+	size_t errors = 0;
+	for (size_t idx = 0; idx < batch.size(); idx ++)
+	{
+		auto & results = batch[idx];
+		std::sort(results.begin(), results.end(), [](const auto & lhs, const auto & rhs) { return lhs.rect.x < rhs.rect.x or (lhs.rect.x == rhs.rect.x and lhs.rect.y < rhs.rect.y); });
+
+		bool same = (results.size() == single.size());
+		for (size_t n = 0; same and n < results.size(); n ++)
+		{
+			same =	results[n].rect			== single[n].rect		and
+					results[n].best_class	== single[n].best_class	and
+					std::abs(results[n].best_probability - single[n].best_probability) < 0.0001f;
+		}
+
+		if (not same)
+		{
+			std::cout
+				<< "batch image #" << idx << " does not match predict():" << std::endl
+				<< "-> predict(): " << single << std::endl
+				<< "-> predict_batch(): " << results << std::endl;
+			errors ++;
+		}
+	}
+
+	return errors;
+}
+
+
+int main(int argc, char * argv[])
+{
+	int rc = 0;
+
+	try
+	{
+		if (argc != 5 and argc != 6)
+		{
+			std::cout
+				<< "Usage:" << std::endl
+				<< argv[0] << " <filename.cfg> <filename.names> <filename.weights> <filename.jpg> [batch size]" << std::endl;
+			throw std::invalid_argument("wrong number of arguments");
+		}
+
+		const std::string cfg		= argv[1];
+		const std::string names		= argv[2];
+		const std::string weights	= argv[3];
+		const std::string filename	= argv[4];
+		const int batch_size		= (argc == 6 ? std::stoi(argv[5]) : 4);
+
+		const cv::Mat mat = cv::imread(filename);
+		if (mat.empty())
+		{
+			throw std::invalid_argument("failed to read image " + filename);
+		}
+
+		// Run the same image N times through both drivers, and make sure every image in the batch gets the same results as predict().
+		for (const auto driver : {DarkHelp::EDriver::kDarknet, DarkHelp::EDriver::kOpenCVCPU})
+		{
+			const std::string name = (driver == DarkHelp::EDriver::kDarknet ? "Darknet" : "OpenCV");
+			const size_t errors = compare_results(driver, cfg, names, weights, mat, batch_size);
+			std::cout << name << ": " << (errors ? std::to_string(errors) + " image(s) did not match" : "batch results match predict()") << std::endl;
+			if (errors)
+			{
+				rc = 1;
+			}
+		}
+	}
+	catch (const std::exception & e)
+	{
+		std::cout << e.what() << std::endl;
+		rc = 1;
+	}
+
+	return rc;
+}
@@ -201,6 +201,7 @@ int main(int argc, char * argv[])
 		std::string previously_seen_objects;
 
 		size_t frame_counter = 0;
+		cv::Mat annotated_frame;
 		while (cap.isOpened() and errors < 5)
 		{
 			cv::Mat frame;
@@ -225,7 +226,14 @@ int main(int argc, char * argv[])
 			}
 
 			const auto results = nn.predict(frame);
-			frame = nn.annotate();
+
+			// annotate directly at the output size, and re-use the same annotated image for every frame
+			cv::Size annotated_size(0, 0);
+			if (resize_after)
+			{
+				annotated_size = DarkHelp::size_keeping_aspect_ratio(frame.size(), options.resize_after);
+			}
+			frame = nn.annotate(annotated_frame, annotated_size);
 
 			// update the map that tracks when an object was last seen
 			for (const auto & pred : results)
@@ -261,11 +269,6 @@ int main(int argc, char * argv[])
 				previously_seen_objects = str;
 			}
 
-			if (resize_after)
-			{
-				frame = DarkHelp::resize_keeping_aspect_ratio(frame, options.resize_after);
-			}
-
 			if (output.isOpened())
 			{
 				output.write(frame);
@@ -118,10 +118,21 @@ namespace DarkHelp
 		kDescending	,		///< Sort predictions using @ref DarkHelp::PredictionResult::best_probability in descending order (high values first, low values last).
 		kPageOrder			///< Sort predictions based @em loosely on where they appear within the image.  From top-to-bottom, and left-to-right.
 	};
+
+	/// @see @ref DarkHelp::Config::tile_fusion  @since 2026-10-17
+	enum class ETileFusion
+	{
+		kMergeEdges			= 0,	///< Combine the predictions near the tile edges using @ref DarkHelp::Config::tile_edge_factor and @ref DarkHelp::Config::tile_rect_factor.
+		kNMS				,		///< Run non-maximal suppression on the predictions from all the tiles.  Normally used with @ref DarkHelp::Config::tile_overlap.
+		kWeightedBoxFusion	,		///< Similar to @p kNMS, but the remaining rectangles are the weighted average of the overlapping rectangles.
+		kAutomatic					///< Use @p kNMS when @ref DarkHelp::Config::tile_overlap is set, otherwise use @p kMergeEdges.  @since 2026-10-18
+	};
 }
 
 #include "DarkHelpPredictionResult.hpp"
 #include "DarkHelpConfig.hpp"
+#include "DarkHelpBufferPool.hpp"
+#include "DarkHelpLabelCache.hpp"
 #include "DarkHelpNN.hpp"
 #include "DarkHelpUtils.hpp"
 #include "DarkHelpPositionTracker.hpp"
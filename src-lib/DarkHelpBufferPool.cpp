@@ -0,0 +1,124 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#include "DarkHelp.hpp"
+
+
+DarkHelp::BufferPool::BufferPool() :
+	reallocations(0)
+{
+	return;
+}
+
+
+DarkHelp::BufferPool::~BufferPool()
+{
+	return;
+}
+
+
+DarkHelp::BufferPool & DarkHelp::BufferPool::clear()
+{
+	mats	.clear();
+	vectors	.clear();
+
+	return *this;
+}
+
+
+cv::Mat & DarkHelp::BufferPool::mat(const std::string & name, const size_t index)
+{
+	auto & buffer = mats[{name, index}];
+
+	// OpenCV may have re-allocated the image since we last looked at it
+	if (buffer.mat.data != buffer.data)
+	{
+		buffer.data = buffer.mat.data;
+		if (buffer.data)
+		{
+			reallocations ++;
+		}
+	}
+
+	return buffer.mat;
+}
+
+
+cv::Mat & DarkHelp::BufferPool::mat(const std::string & name, const cv::Size & size, const int type, const size_t index)
+{
+	cv::Mat & m = mat(name, index);
+
+	if (m.size() != size or m.type() != type)
+	{
+		m.create(size, type);
+		count_reallocations();
+	}
+
+	return m;
+}
+
+
+DarkHelp::VFloat & DarkHelp::BufferPool::floats(const std::string & name, const size_t length, const size_t index)
+{
+	auto & buffer = vectors[{name, index}];
+
+	buffer.v.resize(length);
+	if (buffer.v.data() != buffer.data)
+	{
+		buffer.data = buffer.v.data();
+		if (buffer.data)
+		{
+			reallocations ++;
+		}
+	}
+
+	return buffer.v;
+}
+
+
+size_t DarkHelp::BufferPool::size() const
+{
+	return mats.size() + vectors.size();
+}
+
+
+size_t DarkHelp::BufferPool::reallocation_count() const
+{
+	count_reallocations();
+
+	return reallocations;
+}
+
+
+void DarkHelp::BufferPool::count_reallocations() const
+{
+	for (auto & iter : mats)
+	{
+		auto & buffer = iter.second;
+		if (buffer.mat.data != buffer.data)
+		{
+			buffer.data = buffer.mat.data;
+			if (buffer.data)
+			{
+				reallocations ++;
+			}
+		}
+	}
+
+	for (auto & iter : vectors)
+	{
+		auto & buffer = iter.second;
+		if (buffer.v.data() != buffer.data)
+		{
+			buffer.data = buffer.v.data();
+			if (buffer.data)
+			{
+				reallocations ++;
+			}
+		}
+	}
+
+	return;
+}
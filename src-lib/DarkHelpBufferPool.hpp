@@ -0,0 +1,99 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#pragma once
+
+#include "DarkHelp.hpp"
+
+
+namespace DarkHelp
+{
+	/** Collection of working buffers which are re-used from one prediction to the next.  Each buffer is identified by a
+	 * name and an index, and keeps whatever size it was last given.  When the same buffer is requested again with the
+	 * same size (which is the normal case once the network dimensions are known) no memory is allocated.
+	 *
+	 * Every time a buffer has to be allocated or grown, the reallocation counter is incremented.  This includes memory
+	 * that OpenCV re-allocates when a @p cv::Mat from the pool is passed as an output parameter.  Once the pool has been
+	 * "warmed up" by the first few frames, the counter should remain the same for as long as the image and network sizes
+	 * do not change.
+	 *
+	 * Note the counter only knows about the buffers in the pool.  Memory allocated elsewhere, such as the results returned
+	 * to the caller, is not counted.
+	 *
+	 * ~~~~
+	 * DarkHelp::NN nn("driving.cfg", "driving.weights", "driving.names");
+	 * nn.predict(frame);
+	 * const size_t count = nn.reallocation_count();
+	 * nn.predict(next_frame);
+	 * assert(count == nn.reallocation_count());
+	 * ~~~~
+	 *
+	 * @see @ref DarkHelp::NN::buffers
+	 * @see @ref DarkHelp::NN::reallocation_count()
+	 *
+	 * @since 2026-10-17
+	 */
+	class BufferPool final
+	{
+		public:
+
+			/// Constructor.
+			BufferPool();
+
+			/// Destructor.
+			~BufferPool();
+
+			/// Release all of the buffers.  This does not reset the reallocation counter.
+			BufferPool & clear();
+
+			/** Get the image buffer with the given name.  Use this when the buffer is passed to an OpenCV function as an
+			 * output parameter, in which case OpenCV decides on the size and type of the image.
+			 */
+			cv::Mat & mat(const std::string & name, const size_t index = 0);
+
+			/** Get the image buffer with the given name, making sure it has the requested size and type.  If the buffer
+			 * already has the right size and type then the existing memory is returned as-is; the content is not cleared.
+			 */
+			cv::Mat & mat(const std::string & name, const cv::Size & size, const int type, const size_t index = 0);
+
+			/** Get the float buffer with the given name, resized to the requested length.  Memory is only allocated when
+			 * the length exceeds what the buffer has previously held.
+			 */
+			VFloat & floats(const std::string & name, const size_t length, const size_t index = 0);
+
+			/// The number of buffers in the pool.
+			size_t size() const;
+
+			/** The number of times memory has been allocated for one of the buffers in this pool.  This count is never
+			 * reset, so the difference between two calls is what is of interest.
+			 */
+			size_t reallocation_count() const;
+
+		private:
+
+			using Key = std::pair<std::string, size_t>;
+
+			/// An image buffer, and the memory it was using the last time it was checked.
+			struct MatBuffer
+			{
+				cv::Mat mat;
+				const uint8_t * data = nullptr;
+			};
+
+			/// A float buffer, and the memory it was using the last time it was checked.
+			struct FloatBuffer
+			{
+				VFloat v;
+				const float * data = nullptr;
+			};
+
+			/// Increment the reallocation counter for any buffer which is now using different memory.
+			void count_reallocations() const;
+
+			mutable std::map<Key, MatBuffer>	mats;
+			mutable std::map<Key, FloatBuffer>	vectors;
+			mutable size_t						reallocations;
+	};
+}
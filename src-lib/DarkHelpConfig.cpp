@@ -79,7 +79,10 @@ DarkHelp::Config & DarkHelp::Config::reset()
 	only_combine_similar_predictions	= true;
 	tile_edge_factor					= 0.25f;
 	tile_rect_factor					= 1.20f;
+	tile_overlap						= 0.0f;
+	tile_fusion							= ETileFusion::kAutomatic;
 	modify_batch_and_subdivisions		= true;
+	batch_size							= 1;
 	driver								= EDriver::kInvalid;
 	annotation_suppress_classes			.clear();
 	snapping_enabled					= false;
@@ -91,6 +94,18 @@ DarkHelp::Config & DarkHelp::Config::reset()
 	snapping_limit_grow					= 1.25;
 	redirect_darknet_output				= false; // don't default this to TRUE, it becomes too easy to hide errors!
 	use_fast_image_resize				= true;
+	lazy_prediction_names				= false;
+	resize_image_once_for_tiles			= false;
+	objectness_threshold				= 0.01f;
+	class_agnostic_nms					= false;
+	max_detections						= 0;
+	ignored_classes						.clear();
+	class_thresholds					.clear();
+	snapping_in_parallel				= false;
+	snapping_limit_region				= false;
+	annotation_pixelate_mosaic			= false;
+	annotation_label_cache_size			= 256;
+	reduced_resolution_decode			= false;
 
 	return *this;
 }
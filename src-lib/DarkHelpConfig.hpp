@@ -92,7 +92,8 @@ namespace DarkHelp
 			float hierarchy_threshold;
 
 			/** Non-Maximal Suppression (NMS) threshold suppresses overlapping bounding boxes and only retains the bounding
-			 * box that has the maximum probability of object detection associated with it.  Defaults to @p 0.45.
+			 * box that has the maximum probability of object detection associated with it.  Both the Darknet and the OpenCV
+			 * drivers use @ref DarkHelp::non_maximal_suppression().  Defaults to @p 0.45.
 			 * @see @ref DarkHelp::NN::predict()
 			 *
 			 * Quote: <blockquote> [...] nms works by looking at all bounding boxes that made it past the 'objectness' threshold
@@ -324,8 +325,12 @@ namespace DarkHelp
 			 * The default value for @p DarkHelp::Config::enable_tiles is @p false, meaning that calling @ref DarkHelp::NN::predict()
 			 * wont automatically result in image tiling.
 			 *
+			 * All of the tiles are sent to the neural network using @ref DarkHelp::NN::predict_batch(), so increasing
+			 * @ref DarkHelp::Config::batch_size allows several tiles to be processed at the same time.
+			 *
 			 * @see @ref Tiling
 			 * @see @ref DarkHelp::Config::combine_tile_predictions
+			 * @see @ref DarkHelp::Config::batch_size
 			 * @see @ref DarkHelp::NN::horizontal_tiles
 			 * @see @ref DarkHelp::NN::vertical_tiles
 			 * @see @ref DarkHelp::NN::tile_size
@@ -336,7 +341,8 @@ namespace DarkHelp
 			 * value.  But when loading a neural network for inference as %DarkHelp is designed to help with, @em both of those
 			 * values in the .cfg should be set to @p "1".  When @p modify_batch_and_subdivisions is enabled, %DarkHelp will edit
 			 * the configuration file once @ref DarkHelp::NN::init() is called.  This ensures the values are set as needed prior
-			 * to Darknet loading the .cfg file.
+			 * to Darknet loading the .cfg file.  (If @ref batch_size has been set to a value larger than @p 1, then that value
+			 * is used for @p "batch=..." instead.)
 			 *
 			 * The default value for @p modify_batch_and_subdivisions is @p true, meaning the .cfg file will be modified.  If set
 			 * to @p false, %DarkHelp will not modify the configuration file.
@@ -357,6 +363,36 @@ namespace DarkHelp
 			 */
 			bool modify_batch_and_subdivisions;
 
+			/** The number of images the neural network processes in a single forward pass.  This is used by
+			 * @ref DarkHelp::NN::predict_batch() to push several images through the network at once, which makes much
+			 * better use of the CPU (and GPU) than processing the images one at a time.
+			 *
+			 * When @ref modify_batch_and_subdivisions is enabled, @ref DarkHelp::NN::init() will write @p "batch=..." to
+			 * the @p [net] section of the .cfg file using this value (and @p "subdivisions=1").  The value is also passed
+			 * to Darknet when the network is loaded.  This means it must be set @em before @ref DarkHelp::NN::init() is
+			 * called.  Changing the value afterwards requires the network to be re-loaded.
+			 *
+			 * Calls to @ref DarkHelp::NN::predict() continue to work when the batch size is larger than @p 1, but only the
+			 * first slot in the batch is used.  The default is @p 1.
+			 *
+			 * When @ref enable_tiles is used, the tiles are also sent to the network in batches.  Setting the batch size to
+			 * the number of tiles (for example @p 6 for a 3x2 grid) means each large image needs a single forward pass.
+			 *
+			 * Example use:
+			 *
+			 * ~~~~
+			 * DarkHelp::Config cfg("cars.cfg", "cars_best.weights", "cars.names");
+			 * cfg.batch_size = 4;
+			 * DarkHelp::NN nn(cfg);
+			 * const auto results = nn.predict_batch({mat1, mat2, mat3, mat4});
+			 * ~~~~
+			 *
+			 * @see @ref DarkHelp::NN::predict_batch()
+			 *
+			 * @since 2026-10-17
+			 */
+			int batch_size;
+
 			/** Determines which classes to suppress during the call to @ref DarkHelp::NN::annotate().  Any prediction returned
 			 * by Darknet for a class listed in this @p std::set will be ignored:  no bounding box will be drawn, and no label
 			 * will be shown.  The set may be modified at any point and will take effect the next time
@@ -386,7 +422,8 @@ namespace DarkHelp
 			 *
 			 * @note This does not suppress the @em detection of classes.  The vector returned when calling
 			 * @ref DarkHelp::NN::predict() will contain all of the objects found by Darknet, regardless of what
-			 * classes are listed in @p DarkHelp::Config::annotation_suppress_classes.
+			 * classes are listed in @p DarkHelp::Config::annotation_suppress_classes.  To prevent classes from being
+			 * detected, see @ref DarkHelp::Config::ignored_classes.
 			 */
 			std::set<int> annotation_suppress_classes;
 
@@ -467,6 +504,40 @@ namespace DarkHelp
 			 */
 			float tile_rect_factor;
 
+			/** The amount by which neighbouring tiles overlap when @ref enable_tiles is used.  Values less than @p 1.0 are a
+			 * fraction of the tile size, so @p 0.1 means each tile extends by an extra 5% on each side shared with another
+			 * tile.  Values of @p 1.0 or more are a number of pixels.  Objects cut by a tile border are then seen in full by
+			 * at least one of the tiles, and the duplicates are removed using @ref tile_fusion.  Defaults to @p 0.0, meaning
+			 * the tiles do not overlap.
+			 *
+			 * ~~~~
+			 * DarkHelp::NN nn("cars.cfg", "cars.weights", "cars.names");
+			 * nn.config.enable_tiles	= true;
+			 * nn.config.tile_overlap	= 0.15f;
+			 * nn.config.tile_fusion	= DarkHelp::ETileFusion::kWeightedBoxFusion;
+			 * ~~~~
+			 *
+			 * @see @ref tile_fusion
+			 *
+			 * @since 2026-10-17
+			 */
+			float tile_overlap;
+
+			/** Determines how the predictions from the different tiles are combined.  The default is
+			 * @ref DarkHelp::ETileFusion::kAutomatic, which uses @ref DarkHelp::ETileFusion::kMergeEdges when the tiles don't
+			 * overlap, and @ref DarkHelp::ETileFusion::kNMS when @ref tile_overlap is set.
+			 *
+			 * @ref DarkHelp::ETileFusion::kMergeEdges uses @ref combine_tile_predictions, @ref tile_edge_factor, and
+			 * @ref tile_rect_factor to join predictions which were cut in two by a tile border.  It is not meant to be used
+			 * with overlapping tiles.  @ref DarkHelp::ETileFusion::kNMS and @ref DarkHelp::ETileFusion::kWeightedBoxFusion
+			 * use @ref non_maximal_suppression_threshold to decide which predictions are duplicates.
+			 *
+			 * @see @ref DarkHelp::fuse_predictions()
+			 *
+			 * @since 2026-10-17
+			 */
+			ETileFusion tile_fusion;
+
 			/** The @p driver initialization happens in @ref DarkHelp::NN::init().  If you change
 			 * this configuration value, you must remember to call @ref DarkHelp::NN::init() to
 			 * force the neural network to be re-initialized.
@@ -595,5 +666,172 @@ namespace DarkHelp
 			 * @since 2023-07-08
 			 */
 			bool use_fast_image_resize;
+
+			/** When set to @p true, the label text in @ref DarkHelp::PredictionResult::name is not built during prediction.
+			 * Building the names means string concatenation and number formatting for every object on every frame, which
+			 * is wasted effort for applications that only look at the class IDs, probabilities, and rectangles.  The names
+			 * are then built on demand by @ref DarkHelp::NN::annotate(), or when the application calls
+			 * @ref DarkHelp::NN::name_predictions().  Defaults to @p false.
+			 *
+			 * ~~~~
+			 * DarkHelp::NN nn("cars.cfg", "cars.weights", "cars.names");
+			 * nn.config.lazy_prediction_names = true;
+			 * auto results = nn.predict(frame);	// results[n].name is empty
+			 * nn.name_predictions();				// nn.prediction_results[n].name is now set
+			 * ~~~~
+			 *
+			 * @see @ref DarkHelp::NN::name_predictions()
+			 *
+			 * @since 2026-10-17
+			 */
+			bool lazy_prediction_names;
+
+			/** When tiling is enabled, resize the entire image just once to exactly fit all the tiles at the network
+			 * dimensions, and then slice each tile out of that resized image.  This replaces one @p cv::resize() call per
+			 * tile, and the tiles are then passed to the network without being copied again.  The tile boundaries are
+			 * the same, but the predictions may be very slightly different since the resizing is done across the
+			 * whole image.  This is ignored when @ref snapping_enabled is set, since snapping needs each tile in its
+			 * original resolution.  Defaults to @p false.
+			 *
+			 * @see @ref enable_tiles
+			 * @see @ref use_fast_image_resize
+			 *
+			 * @since 2026-10-17
+			 */
+			bool resize_image_once_for_tiles;
+
+			/** Minimum "objectness" value a row of the YOLO output must have before the individual class probabilities
+			 * are examined.  This is only used by the OpenCV DNN driver, since Darknet applies its own objectness
+			 * check.  Most rows in the YOLO output have an objectness very close to zero, so this quickly discards the
+			 * majority of the output.  Defaults to @p 0.01.
+			 *
+			 * @see @ref threshold
+			 *
+			 * @since 2026-10-17
+			 */
+			float objectness_threshold;
+
+			/** When set to @p true, non-maximal suppression is applied across all classes, meaning a prediction can
+			 * suppress an overlapping prediction even when the two are not the same class.  When set to @p false, only
+			 * predictions of the same class are compared.  This applies to both the Darknet and OpenCV drivers, as
+			 * well as to @ref tile_fusion.  Defaults to @p false.
+			 *
+			 * @see @ref non_maximal_suppression_threshold
+			 * @see @ref DarkHelp::non_maximal_suppression()
+			 *
+			 * @since 2026-10-17
+			 */
+			bool class_agnostic_nms;
+
+			/** The maximum number of predictions to return.  When there are more predictions than this, only the ones
+			 * with the highest @ref DarkHelp::PredictionResult::best_probability are kept.  This is applied before the
+			 * predictions are named, sorted, and snapped, so the work done on the results is bounded regardless of how
+			 * many objects are in the image.  When tiling, this is applied to each tile and once again to the combined
+			 * results.  Set to @p 0 to return all predictions.  Defaults to @p 0.
+			 *
+			 * @see @ref sort_predictions
+			 *
+			 * @since 2026-10-17
+			 */
+			size_t max_detections;
+
+			/** Classes which are completely ignored when the network output is decoded.  Unlike
+			 * @ref annotation_suppress_classes which only impacts what is drawn by @ref DarkHelp::NN::annotate(), the
+			 * predictions for these classes are never created, so they are not named, sorted, snapped, or returned by
+			 * @ref DarkHelp::NN::predict().  This is useful for networks which have auxiliary classes that are never
+			 * used.  Defaults to an empty set.
+			 *
+			 * @see @ref class_thresholds
+			 *
+			 * @since 2026-10-17
+			 */
+			std::set<int> ignored_classes;
+
+			/** Per-class thresholds to use instead of @ref threshold.  The vector is indexed by class, and does not need
+			 * to include every class.  Classes which are not in the vector, or which have a negative value, use
+			 * @ref threshold.  For example, to use a threshold of 75% for class #2 and the default threshold for all
+			 * other classes:
+			 *
+			 * ~~~~{.cpp}
+			 * DarkHelp::NN nn("cars.cfg", "cars.weights", "cars.names");
+			 * nn.config.class_thresholds = {-1.0f, -1.0f, 0.75f};
+			 * ~~~~
+			 *
+			 * Defaults to an empty vector.
+			 *
+			 * @see @ref ignored_classes
+			 *
+			 * @since 2026-10-17
+			 */
+			VFloat class_thresholds;
+
+			/** When snapping is enabled, snap the annotations in parallel using OpenCV's thread pool.  The results are
+			 * exactly the same as when the annotations are snapped one at a time.  This is mostly useful with images
+			 * that have many annotations, such as documents.  Defaults to @p false.
+			 *
+			 * @see @ref snapping_enabled
+			 * @see @ref DarkHelp::NN::snap_annotations()
+			 *
+			 * @since 2026-10-17
+			 */
+			bool snapping_in_parallel;
+
+			/** When snapping is enabled, only threshold and search the area around each annotation instead of the entire
+			 * image.  The area extends beyond the annotation by the snapping tolerance plus the growth allowed by
+			 * @ref snapping_limit_grow.  This is much faster on large images with few annotations, but the results may be
+			 * different:  an annotation cannot snap to anything outside of that area, even when @ref snapping_limit_grow
+			 * is less than @p 1 (which normally means growth is not limited), or when an annotation grows in one
+			 * dimension while shrinking in the other.  Defaults to @p false, meaning the entire image is searched.
+			 *
+			 * @see @ref snapping_enabled
+			 * @see @ref snapping_limit_grow
+			 *
+			 * @since 2026-10-18
+			 */
+			bool snapping_limit_region;
+
+			/** When pixelation is enabled, fill each cell with the average colour instead of the dominant colour.  This
+			 * shrinks each pixelated rectangle down to 1 pixel per cell and then enlarges it back to the original size,
+			 * which is much faster than looking for the dominant colour of each cell.  Defaults to @p false.
+			 *
+			 * @see @ref annotation_pixelate_enabled
+			 * @see @ref annotation_pixelate_size
+			 * @see @ref DarkHelp::pixelate_rectangle()
+			 *
+			 * @since 2026-10-17
+			 */
+			bool annotation_pixelate_mosaic;
+
+			/** The maximum number of rendered labels which @ref DarkHelp::NN::annotate() keeps in memory.  Instead of
+			 * calling @p cv::putText() for every label of every frame, each label is rendered once and then copied into
+			 * the annotated image.  This includes the duration and timestamp, which are kept in a separate small cache so
+			 * they never push the prediction labels out.  When the cache is full, the labels which have not been used for
+			 * the longest time are discarded.  Set to @p 0 to disable the cache and render every label directly into the
+			 * annotated image.  Defaults to @p 256.
+			 *
+			 * @see @ref DarkHelp::LabelCache
+			 *
+			 * @since 2026-10-17
+			 */
+			size_t annotation_label_cache_size;
+
+			/** When @ref DarkHelp::NN::predict() is given the filename of a JPEG image which is at least twice the size of
+			 * the network in both dimensions, let the JPEG decoder downscale the image by a factor of 2, 4, or 8 while it is
+			 * decoded.  This is much faster and uses much less memory than decoding the full image only to throw away most
+			 * of the pixels when the image is resized to the network dimensions.  The predictions are scaled back to the
+			 * full size of the image.  This is ignored when @ref enable_tiles is set, since tiling needs the full image.
+			 * Defaults to @p false.
+			 *
+			 * @note @ref DarkHelp::NN::original_image will be the reduced image, so @ref DarkHelp::NN::annotate() also
+			 * returns an image at the reduced size.  @ref DarkHelp::NN::original_image_size is the full size of the image,
+			 * which can be passed to @ref DarkHelp::NN::annotate() to get an annotated image at full size.
+			 * @ref DarkHelp::DHThreads does this when it writes annotated images.
+			 *
+			 * @see @ref DarkHelp::read_image()
+			 * @see @ref DarkHelp::NN::predict_reduced()
+			 *
+			 * @since 2026-10-17
+			 */
+			bool reduced_resolution_decode;
 	};
 }
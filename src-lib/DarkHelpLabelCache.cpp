@@ -0,0 +1,152 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#include "DarkHelp.hpp"
+
+
+DarkHelp::LabelCache::LabelCache() :
+	capacity(256),
+	hit_count(0),
+	miss_count(0)
+{
+	return;
+}
+
+
+DarkHelp::LabelCache::~LabelCache()
+{
+	return;
+}
+
+
+DarkHelp::LabelCache & DarkHelp::LabelCache::clear()
+{
+	index	.clear();
+	entries	.clear();
+
+	return *this;
+}
+
+
+DarkHelp::LabelCache & DarkHelp::LabelCache::set_capacity(const size_t max_labels)
+{
+	capacity = max_labels;
+	trim();
+
+	return *this;
+}
+
+
+const DarkHelp::LabelCache::Label & DarkHelp::LabelCache::get(const std::string & text, const int font_face, const double font_scale, const int font_thickness, const cv::Scalar & background, const int horizontal_padding, const int vertical_padding, const int type)
+{
+	// assigning the text re-uses the memory already allocated by the lookup key
+	lookup.text					.assign(text);
+	lookup.font_face			= font_face;
+	lookup.font_scale			= font_scale;
+	lookup.font_thickness		= font_thickness;
+	lookup.background			= background;
+	lookup.horizontal_padding	= horizontal_padding;
+	lookup.vertical_padding		= vertical_padding;
+	lookup.type					= type;
+
+	auto iter = index.find(lookup);
+	if (iter != index.end())
+	{
+		// move this label to the front of the list since it is now the most recently used
+		hit_count ++;
+		entries.splice(entries.begin(), entries, iter->second);
+
+		return entries.front().second;
+	}
+
+	miss_count ++;
+
+	Label label;
+	label.baseline = 0;
+	label.text_size = cv::getTextSize(text, font_face, font_scale, font_thickness, &label.baseline);
+
+	const int bottom = (vertical_padding < 0 ? label.baseline : vertical_padding);
+	label.image = cv::Mat(label.text_size.height + bottom, label.text_size.width + horizontal_padding, type, background);
+	cv::putText(label.image, text, cv::Point(horizontal_padding / 2, label.text_size.height), font_face, font_scale, cv::Scalar(0, 0, 0), font_thickness, cv::LINE_AA);
+
+	entries.emplace_front(lookup, std::move(label));
+	index[entries.front().first] = entries.begin();
+
+	trim();
+
+	return entries.front().second;
+}
+
+
+size_t DarkHelp::LabelCache::size() const
+{
+	return entries.size();
+}
+
+
+size_t DarkHelp::LabelCache::hits() const
+{
+	return hit_count;
+}
+
+
+size_t DarkHelp::LabelCache::misses() const
+{
+	return miss_count;
+}
+
+
+void DarkHelp::LabelCache::trim()
+{
+	// the most recent label is always kept so the reference returned by get() remains valid
+	while (entries.size() > std::max(capacity, static_cast<size_t>(1)))
+	{
+		index.erase(entries.back().first);
+		entries.pop_back();
+	}
+
+	return;
+}
+
+
+bool DarkHelp::LabelCache::Key::operator==(const Key & rhs) const
+{
+	return	text				== rhs.text					and
+			font_face			== rhs.font_face			and
+			font_scale			== rhs.font_scale			and
+			font_thickness		== rhs.font_thickness		and
+			background[0]		== rhs.background[0]		and
+			background[1]		== rhs.background[1]		and
+			background[2]		== rhs.background[2]		and
+			background[3]		== rhs.background[3]		and
+			horizontal_padding	== rhs.horizontal_padding	and
+			vertical_padding	== rhs.vertical_padding		and
+			type				== rhs.type;
+}
+
+
+size_t DarkHelp::LabelCache::KeyHash::operator()(const Key & key) const
+{
+	// the text is by far the most important part, the rest is mixed in so different colours of the same text do not collide
+	size_t h = std::hash<std::string>()(key.text);
+
+	const auto combine = [&h](const size_t value)
+	{
+		h ^= value + 0x9e3779b9 + (h << 6) + (h >> 2);
+	};
+
+	combine(std::hash<int>()(key.font_face));
+	combine(std::hash<double>()(key.font_scale));
+	combine(std::hash<int>()(key.font_thickness));
+	for (int idx = 0; idx < 4; idx ++)
+	{
+		combine(std::hash<double>()(key.background[idx]));
+	}
+	combine(std::hash<int>()(key.horizontal_padding));
+	combine(std::hash<int>()(key.vertical_padding));
+	combine(std::hash<int>()(key.type));
+
+	return h;
+}
@@ -0,0 +1,110 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#pragma once
+
+#include "DarkHelp.hpp"
+#include <unordered_map>
+
+
+namespace DarkHelp
+{
+	/** Cache of labels which have already been rendered by @ref DarkHelp::NN::annotate().  Rendering text with OpenCV's
+	 * Hershey fonts is expensive, but labels are drawn from a small set of class names and percentages, so the same
+	 * labels are drawn over and over.  Each label is rendered once into a small image which is then copied into the
+	 * annotated image.
+	 *
+	 * The labels are identified by the text, the font, the background colour, and the padding around the text.  When
+	 * the cache is full, the label which has not been used for the longest time is discarded.
+	 *
+	 * @see @ref DarkHelp::Config::annotation_label_cache_size
+	 *
+	 * @since 2026-10-17
+	 */
+	class LabelCache final
+	{
+		public:
+
+			/// A label which has been rendered.
+			struct Label
+			{
+				cv::Mat		image;		///< The rendered label, including the background and padding.
+				cv::Size	text_size;	///< Size of the text as returned by @p cv::getTextSize().
+				int			baseline;	///< Baseline of the text as returned by @p cv::getTextSize().
+			};
+
+			/// Constructor.
+			LabelCache();
+
+			/// Destructor.
+			~LabelCache();
+
+			/// Remove all labels from the cache.  This does not reset the statistics.
+			LabelCache & clear();
+
+			/// Set the maximum number of labels to keep in the cache.  Labels are discarded if there are too many.
+			LabelCache & set_capacity(const size_t max_labels);
+
+			/** Get the rendered label, rendering it if it isn't already in the cache.  The text is drawn in black.
+			 *
+			 * @param [in] text The text of the label.
+			 * @param [in] font_face See @ref DarkHelp::Config::annotation_font_face.
+			 * @param [in] font_scale See @ref DarkHelp::Config::annotation_font_scale.
+			 * @param [in] font_thickness See @ref DarkHelp::Config::annotation_font_thickness.
+			 * @param [in] background The colour of the label background.
+			 * @param [in] horizontal_padding The number of pixels added to the width of the text.  The text is centered.
+			 * @param [in] vertical_padding The number of pixels added below the text.  If negative, the baseline is used.
+			 * @param [in] type The OpenCV image type, such as @p CV_8UC3.
+			 *
+			 * @note The reference returned remains valid until the next call.
+			 */
+			const Label & get(const std::string & text, const int font_face, const double font_scale, const int font_thickness, const cv::Scalar & background, const int horizontal_padding, const int vertical_padding, const int type);
+
+			/// The number of labels in the cache.
+			size_t size() const;
+
+			/// The number of times a label was found in the cache.
+			size_t hits() const;
+
+			/// The number of times a label had to be rendered.
+			size_t misses() const;
+
+		private:
+
+			/// Everything that impacts how the label is rendered.
+			struct Key
+			{
+				std::string	text;
+				int			font_face;
+				double		font_scale;
+				int			font_thickness;
+				cv::Scalar	background;
+				int			horizontal_padding;
+				int			vertical_padding;
+				int			type;
+
+				bool operator==(const Key & rhs) const;
+			};
+
+			/// Hash function for @ref Key.
+			struct KeyHash
+			{
+				size_t operator()(const Key & key) const;
+			};
+
+			using Entry		= std::pair<Key, Label>;
+			using Entries	= std::list<Entry>;
+
+			/// Remove the least recently used labels until the cache is no larger than the capacity.
+			void trim();
+
+			Entries											entries; ///< Most recently used labels are at the front.
+			std::unordered_map<Key, Entries::iterator, KeyHash>	index;
+			Key												lookup; ///< Re-used by @ref get() so the text is not copied into a new string on every call.
+			size_t											capacity;
+			size_t											hit_count;
+			size_t											miss_count;
+	};
+}
@@ -12,12 +12,17 @@
 #include <regex>
 #include <cmath>
 #include <ctime>
+#include <limits>
 #include <sys/stat.h>
 
 #ifdef HAVE_OPENCV_CUDAWARPING
 #include <opencv2/cudawarping.hpp>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
 #ifdef WIN32
 #pragma warning(disable: 4267)
 #pragma warning(disable: 4244)
@@ -206,11 +211,16 @@ DarkHelp::NN & DarkHelp::NN::init()
 		throw std::invalid_argument("cannot initialize the network without a .cfg or .weights file");
 	}
 
+	if (config.batch_size < 1)
+	{
+		config.batch_size = 1;
+	}
+
 	if (config.modify_batch_and_subdivisions)
 	{
 		const MStr m =
 		{
-			{"batch"		, "1"},
+			{"batch"		, std::to_string(config.batch_size)},
 			{"subdivisions"	, "1"}
 		};
 		edit_cfg_file(config.cfg_filename, m);
@@ -238,7 +248,7 @@ DarkHelp::NN & DarkHelp::NN::init()
 			toggle_output_redirection();
 		}
 
-		darknet_net = load_network_custom(const_cast<char*>(config.cfg_filename.c_str()), const_cast<char*>(config.weights_filename.c_str()), 1, 1);
+		darknet_net = load_network_custom(const_cast<char*>(config.cfg_filename.c_str()), const_cast<char*>(config.weights_filename.c_str()), 1, config.batch_size);
 
 		if (config.redirect_darknet_output)
 		{
@@ -276,6 +286,19 @@ DarkHelp::NN & DarkHelp::NN::init()
 		opencv_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
 		opencv_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
 #endif
+
+		/* Get the names of all the layers we're interested in (should start with "yolo_").
+		 * This is important!  We're going to have to combine the results from all these layers.
+		 * The layers don't change once the network is loaded, so this is only done once.
+		 */
+		yolo_layer_names.clear();
+		for (const auto & name : opencv_net.getLayerNames())
+		{
+			if (name.find("yolo_") == 0)
+			{
+				yolo_layer_names.push_back(name);
+			}
+		}
 	}
 #endif
 
@@ -356,6 +379,14 @@ DarkHelp::NN & DarkHelp::NN::init()
 		throw std::invalid_argument("invalid number of channels in " + config.cfg_filename);
 	}
 
+	// now that we know the network dimensions we can allocate the working buffers needed for each frame
+	buffers.clear();
+	buffers.mat("resized", network_dimensions, CV_8UC(number_of_channels));
+	if (config.driver == EDriver::kDarknet)
+	{
+		buffers.floats("input", static_cast<size_t>(network_dimensions.area()) * number_of_channels * config.batch_size);
+	}
+
 	// OpenCV's construction uses lazy initialization, and doesn't actually happen until we call into it.
 	// This can have a huge impact on FPS calculations when the initial image pauses for a "long" time as
 	// the network is loaded.  So pass a "dummy" image through the network to force everything to load.
@@ -395,6 +426,13 @@ DarkHelp::NN & DarkHelp::NN::reset()
 	#ifdef HAVE_OPENCV_DNN_OBJDETECT
 		opencv_net = cv::dnn::Net();
 	#endif
+	yolo_layer_names.clear();
+	output_mats.clear();
+	nms_candidates.clear();
+	decode_thresholds.clear();
+	lowest_decode_threshold = 0.0f;
+	labels.clear();
+	overlay_labels.clear();
 
 	clear();
 	names.clear();
@@ -410,6 +448,7 @@ DarkHelp::NN & DarkHelp::NN::clear()
 {
 	prediction_results		.clear();
 	original_image			= cv::Mat();
+	original_image_size		= cv::Size(0, 0);
 	binary_inverted_image	= cv::Mat();
 	annotated_image			= cv::Mat();
 	horizontal_tiles		= 1;
@@ -449,14 +488,50 @@ bool DarkHelp::NN::empty() const
 
 DarkHelp::PredictionResults DarkHelp::NN::predict(const std::string & image_filename, const float new_threshold)
 {
-	cv::Mat mat = cv::imread(image_filename);
+	// tiling needs the image at full resolution
+	cv::Size minimum_size(0, 0);
+	if (config.reduced_resolution_decode and not config.enable_tiles)
+	{
+		minimum_size = network_dimensions;
+	}
+
+	cv::Size original_size;
+	cv::Mat mat = read_image(image_filename, minimum_size, original_size);
 	if (mat.empty())
 	{
 		/// @throw std::invalid_argument if the image failed to load.
 		throw std::invalid_argument("failed to load image \"" + image_filename + "\"");
 	}
 
-	return predict(mat, new_threshold);
+	return predict_reduced(mat, original_size, new_threshold);
+}
+
+
+DarkHelp::PredictionResults DarkHelp::NN::predict_reduced(cv::Mat mat, const cv::Size & original_size, const float new_threshold)
+{
+	auto results = predict(mat, new_threshold);
+
+	if (original_size.area() <= 0 or original_size == mat.size())
+	{
+		return results;
+	}
+
+	const double horizontal_scale	= static_cast<double>(original_size.width)	/ static_cast<double>(mat.cols);
+	const double vertical_scale		= static_cast<double>(original_size.height)	/ static_cast<double>(mat.rows);
+	const cv::Rect bounds(0, 0, original_size.width, original_size.height);
+
+	// the normalized coordinates don't change, only the rectangles need to be scaled
+	for (auto & pred : prediction_results)
+	{
+		const cv::Rect & r = pred.rect;
+		const cv::Point tl(std::round(r.x * horizontal_scale), std::round(r.y * vertical_scale));
+		const cv::Point br(std::round((r.x + r.width) * horizontal_scale), std::round((r.y + r.height) * vertical_scale));
+		pred.rect = cv::Rect(tl, br) & bounds;
+	}
+
+	original_image_size = original_size;
+
+	return prediction_results;
 }
 
 
@@ -519,22 +594,70 @@ DarkHelp::PredictionResults DarkHelp::NN::predict_tile(cv::Mat mat, const float
 
 	// otherwise, if we get here then we have more than 1 tile
 
-	// divide the original image into the right number of tiles and call predict() on each tile
+	// divide the original image into the right number of tiles
 	PredictionResults results;
 	std::vector<size_t> indexes_of_predictions_near_edges;
 	std::vector<cv::Mat> all_tile_mats;
-	std::chrono::high_resolution_clock::duration total_duration = std::chrono::milliseconds(0);
+	std::vector<cv::Rect> all_tile_rects;
+
+	/* Instead of resizing each tile individually, the whole image can be resized once so that each tile is exactly the
+	 * size of the network.  The tiles are then sliced out of the resized image without any further copies.  Snapping
+	 * needs to look at the tiles in their original resolution, so this cannot be used when snapping is enabled.
+	 */
+	int horizontal_overlap	= std::round(config.tile_overlap < 1.0f ? config.tile_overlap * tile_width	: config.tile_overlap);
+	int vertical_overlap	= std::round(config.tile_overlap < 1.0f ? config.tile_overlap * tile_height	: config.tile_overlap);
+	horizontal_overlap		= std::max(0, horizontal_overlap);
+	vertical_overlap		= std::max(0, vertical_overlap);
+
+	// merging the edges only makes sense when the tiles don't overlap, otherwise the duplicates need to be suppressed
+	ETileFusion tile_fusion = config.tile_fusion;
+	if (tile_fusion == ETileFusion::kAutomatic)
+	{
+		tile_fusion = (horizontal_overlap > 0 or vertical_overlap > 0 ? ETileFusion::kNMS : ETileFusion::kMergeEdges);
+	}
+
+	const bool resize_once = config.resize_image_once_for_tiles and not config.snapping_enabled and horizontal_overlap == 0 and vertical_overlap == 0;
+	if (resize_once)
+	{
+		const cv::Size all_tiles_size(horizontal_tiles_count * network_dimensions.width, vertical_tiles_count * network_dimensions.height);
+		cv::Mat & all_tiles = buffers.mat("tiles");
+		if (config.use_fast_image_resize)
+		{
+			fast_resize_ignore_aspect_ratio(mat, all_tiles_size, all_tiles);
+		}
+		else
+		{
+			slow_resize_ignore_aspect_ratio(mat, all_tiles_size, all_tiles);
+		}
+	}
 
 	for (float y = 0.0f; y < vertical_tiles_count; y ++)
 	{
 		for (float x = 0.0f; x < horizontal_tiles_count; x ++)
 		{
-			const int tile_count = y * horizontal_tiles_count + x;
-
 			const int x_offset = std::round(x * tile_width);
 			const int y_offset = std::round(y * tile_height);
 			cv::Rect r(cv::Point(x_offset, y_offset), new_tile_size);
 
+			if (resize_once)
+			{
+				// rounding the tile offsets may put the last tile slightly beyond the edge of the image
+				r &= cv::Rect(0, 0, mat.cols, mat.rows);
+
+				// the tile in the resized image is exactly the size of the network
+				const cv::Rect network_rect(cv::Point(x * network_dimensions.width, y * network_dimensions.height), network_dimensions);
+				all_tile_mats	.push_back(buffers.mat("tiles")(network_rect));
+				all_tile_rects	.push_back(r);
+				continue;
+			}
+
+			// when the tiles overlap, each tile extends by half the overlap on every side, but never beyond the image
+			r.x			-= horizontal_overlap / 2;
+			r.y			-= vertical_overlap / 2;
+			r.width		+= horizontal_overlap;
+			r.height	+= vertical_overlap;
+			r &= cv::Rect(0, 0, mat.cols, mat.rows);
+
 			// make sure the rectangle does not extend beyond the edges of the image
 			if (r.x + r.width >= mat.cols)
 			{
@@ -545,178 +668,272 @@ DarkHelp::PredictionResults DarkHelp::NN::predict_tile(cv::Mat mat, const float
 				r.height = mat.rows - r.y - 1;
 			}
 
-			cv::Mat roi = mat(r);
+			all_tile_mats	.push_back(mat(r));
+			all_tile_rects	.push_back(r);
+		}
+	}
+
+	/* Run all of the tiles through the network.  The tiles are grouped using the batch size, so when
+	 * DarkHelp::Config::batch_size is at least the number of tiles, the whole image is processed in
+	 * a single forward pass instead of one forward pass per tile.
+	 */
+	auto all_tile_results = predict_batch(all_tile_mats, new_threshold);
+	const auto total_duration = duration;
 
-			predict_internal(roi, new_threshold);
+	for (size_t tile_count = 0; tile_count < all_tile_mats.size(); tile_count ++)
+	{
+		const cv::Rect & roi = all_tile_rects[tile_count];
+		const int x_offset = roi.x;
+		const int y_offset = roi.y;
 
-			total_duration += duration;
+		// fix up the predictions -- need to compensate for the tile not being the top-left corner of the image, and the size of the tile being smaller than the image
+		for (auto & prediction : all_tile_results[tile_count])
+		{
+			if (resize_once)
+			{
+				// the rectangle was calculated using the resized tile, so use the normalized values to get the rectangle within the original tile
+				const int w = std::round(prediction.original_size.width		* roi.width);
+				const int h = std::round(prediction.original_size.height	* roi.height);
+				const int x = std::round(prediction.original_point.x		* roi.width		- w / 2.0);
+				const int y = std::round(prediction.original_point.y		* roi.height	- h / 2.0);
+				prediction.rect = cv::Rect(x, y, w, h);
+			}
 
-			// fix up the predictions -- need to compensate for the tile not being the top-left corner of the image, and the size of the tile being smaller than the image
-			for (auto & prediction : prediction_results)
+			// track which predictions are near the edges, because we may need to re-examine them and join them after we finish with all the tiles
+			if (config.combine_tile_predictions and tile_fusion == ETileFusion::kMergeEdges)
 			{
-				// track which predictions are near the edges, because we may need to re-examine them and join them after we finish with all the tiles
-				if (config.combine_tile_predictions)
+				const int minimum_horizontal_distance	= config.tile_edge_factor * prediction.rect.width;
+				const int minimum_vertical_distance		= config.tile_edge_factor * prediction.rect.height;
+				if (prediction.rect.x <= minimum_horizontal_distance					or
+					prediction.rect.y <= minimum_vertical_distance						or
+					roi.width - prediction.rect.br().x <= minimum_horizontal_distance	or
+					roi.height - prediction.rect.br().y <= minimum_vertical_distance	)
 				{
-					const int minimum_horizontal_distance	= config.tile_edge_factor * prediction.rect.width;
-					const int minimum_vertical_distance		= config.tile_edge_factor * prediction.rect.height;
-					if (prediction.rect.x <= minimum_horizontal_distance					or
-						prediction.rect.y <= minimum_vertical_distance						or
-						roi.cols - prediction.rect.br().x <= minimum_horizontal_distance	or
-						roi.rows - prediction.rect.br().y <= minimum_vertical_distance		)
-					{
-						// this prediction is near one of the tile borders so we need to remember it
-						indexes_of_predictions_near_edges.push_back(results.size());
-					}
+					// this prediction is near one of the tile borders so we need to remember it
+					indexes_of_predictions_near_edges.push_back(results.size());
 				}
+			}
 
-				// every prediction needs to have x_offset and y_offset added to it
-				prediction.rect.x += x_offset;
-				prediction.rect.y += y_offset;
-				prediction.tile = tile_count;
+			// every prediction needs to have x_offset and y_offset added to it
+			prediction.rect.x += x_offset;
+			prediction.rect.y += y_offset;
+			prediction.tile = tile_count;
 
-				if (config.enable_debug)
-				{
-					// draw a black-on-white debug label on the top side of the annotation
-
-					const std::string label		= std::to_string(results.size());
-					const auto font				= cv::HersheyFonts::FONT_HERSHEY_PLAIN;
-					const auto scale			= 0.75;
-					const auto thickness		= 1;
-					int baseline				= 0;
-					const cv::Size text_size	= cv::getTextSize(label, font, scale, thickness, &baseline);
-					const int text_half_width	= text_size.width			/ 2;
-					const int text_half_height	= text_size.height			/ 2;
-					const int pred_half_width	= prediction.rect.width		/ 2;
-					const int pred_half_height	= prediction.rect.height	/ 2;
-
-					// put the text exactly in the middle of the prediction
-					const cv::Rect label_rect(
-							prediction.rect.x + pred_half_width - text_half_width,
-							prediction.rect.y + pred_half_height - text_half_height,
-							text_size.width, text_size.height);
-					cv::rectangle(mat, label_rect, {255, 255, 255}, cv::FILLED, cv::LINE_AA);
-					cv::putText(mat, label, cv::Point(label_rect.x, label_rect.y + label_rect.height), font, scale, cv::Scalar(0,0,0), thickness, CV_AA);
-				}
+			if (config.enable_debug)
+			{
+				// draw a black-on-white debug label on the top side of the annotation
+
+				const std::string label		= std::to_string(results.size());
+				const auto font				= cv::HersheyFonts::FONT_HERSHEY_PLAIN;
+				const auto scale			= 0.75;
+				const auto thickness		= 1;
+				int baseline				= 0;
+				const cv::Size text_size	= cv::getTextSize(label, font, scale, thickness, &baseline);
+				const int text_half_width	= text_size.width			/ 2;
+				const int text_half_height	= text_size.height			/ 2;
+				const int pred_half_width	= prediction.rect.width		/ 2;
+				const int pred_half_height	= prediction.rect.height	/ 2;
+
+				// put the text exactly in the middle of the prediction
+				const cv::Rect label_rect(
+						prediction.rect.x + pred_half_width - text_half_width,
+						prediction.rect.y + pred_half_height - text_half_height,
+						text_size.width, text_size.height);
+				cv::rectangle(mat, label_rect, {255, 255, 255}, cv::FILLED, cv::LINE_AA);
+				cv::putText(mat, label, cv::Point(label_rect.x, label_rect.y + label_rect.height), font, scale, cv::Scalar(0,0,0), thickness, CV_AA);
+			}
+
+			// the original point and size are based on only 1 tile, so they also need to be fixed
 
-				// the original point and size are based on only 1 tile, so they also need to be fixed
+			prediction.original_point.x = (static_cast<float>(prediction.rect.x) + static_cast<float>(prediction.rect.width	) / 2.0f) / static_cast<float>(mat.cols);
+			prediction.original_point.y = (static_cast<float>(prediction.rect.y) + static_cast<float>(prediction.rect.height) / 2.0f) / static_cast<float>(mat.rows);
 
-				prediction.original_point.x = (static_cast<float>(prediction.rect.x) + static_cast<float>(prediction.rect.width	) / 2.0f) / static_cast<float>(mat.cols);
-				prediction.original_point.y = (static_cast<float>(prediction.rect.y) + static_cast<float>(prediction.rect.height) / 2.0f) / static_cast<float>(mat.rows);
+			prediction.original_size.width	= static_cast<float>(prediction.rect.width	) / static_cast<float>(mat.cols);
+			prediction.original_size.height	= static_cast<float>(prediction.rect.height	) / static_cast<float>(mat.rows);
 
-				prediction.original_size.width	= static_cast<float>(prediction.rect.width	) / static_cast<float>(mat.cols);
-				prediction.original_size.height	= static_cast<float>(prediction.rect.height	) / static_cast<float>(mat.rows);
+			results.push_back(std::move(prediction));
+		}
+	}
+
+	if (tile_fusion != ETileFusion::kMergeEdges)
+	{
+		// remove the duplicates found where the tiles overlap
+		fuse_predictions(results, mat.size(), config.non_maximal_suppression_threshold, tile_fusion, config.class_agnostic_nms);
 
-				results.push_back(prediction);
+		if (tile_fusion == ETileFusion::kWeightedBoxFusion)
+		{
+			// the probabilities may have been combined, so the best class and the name need to be updated
+			for (auto & pred : results)
+			{
+				name_prediction(pred);
 			}
 		}
 	}
 
 	if (indexes_of_predictions_near_edges.empty() == false)
 	{
-		// we need to go through all the results from the various tiles and merged together the ones that are side-by-side
+		/* We need to go through all the results from the various tiles and merge together the ones that are side-by-side.
+		 *
+		 * Only predictions on neighbouring tiles can be combined, so the edge predictions are first grouped by tile.  Each
+		 * group is then compared against the groups of the adjacent tiles to the right and below (including diagonals).
+		 * Matches are recorded with a union-find structure, which means an object cut into 3 or 4 pieces -- such as an
+		 * object sitting on the corner where 4 tiles meet -- ends up as a single prediction regardless of the order in
+		 * which the pieces are compared.
+		 */
+
+		const int columns			= horizontal_tiles_count;
+		const int rows				= vertical_tiles_count;
+		const size_t tiles_count	= columns * rows;
 
-		for (const auto & lhs_idx : indexes_of_predictions_near_edges)
+		std::vector<std::vector<size_t>> edge_predictions_by_tile(tiles_count);
+		for (const auto & idx : indexes_of_predictions_near_edges)
 		{
-			if (results[lhs_idx].rect.area() == 0 and results[lhs_idx].tile == -1)
+			edge_predictions_by_tile[results[idx].tile].push_back(idx);
+		}
+
+		// each prediction starts out as its own set; the lowest index in a set is always the root
+		std::vector<size_t> parent(results.size());
+		for (size_t idx = 0; idx < parent.size(); idx ++)
+		{
+			parent[idx] = idx;
+		}
+
+		const auto find_root = [&parent](size_t idx)
+		{
+			while (parent[idx] != idx)
 			{
-				// this items has already been consumed and is marked for deletion
-				continue;
+				parent[idx] = parent[parent[idx]];
+				idx = parent[idx];
 			}
+			return idx;
+		};
 
-			const cv::Rect & lhs_rect = results[lhs_idx].rect;
-
-			// now compare this rect against all other rects that come *after* this
-			for (const auto & rhs_idx : indexes_of_predictions_near_edges)
+		const auto is_a_match = [&](const PredictionResult & lhs, const PredictionResult & rhs)
+		{
+			if (config.only_combine_similar_predictions)
 			{
-				if (rhs_idx <= lhs_idx)
+				// check the probabilities to see if there is any similarity:
+				//
+				// 1) does the LHS contain the best class from the RHS?
+				// 2) does the RHS contain the best class from the LHS?
+				//
+				if (lhs.all_probabilities.count(rhs.best_class) == 0 and
+					rhs.all_probabilities.count(lhs.best_class) == 0)
 				{
-					// if the RHS object is on an earlier tile, then we've already compared it
-					continue;
+					// the two objects have completely different classes, so we cannot combine them together
+					return false;
 				}
+			}
 
-				if (results[lhs_idx].tile == results[rhs_idx].tile)
-				{
-					// if two objects are on the exact same tile, don't bother trying to combine them
-					continue;
-				}
+			// if this is a good match, then the area of the combined rect will be similar to the area of lhs+rhs
+			const cv::Rect combined_rect	= lhs.rect | rhs.rect;
+			const int lhs_plus_rhs			= (lhs.rect.area() + rhs.rect.area()) * config.tile_rect_factor;
+
+			return combined_rect.area() <= lhs_plus_rhs;
+		};
+
+		// the neighbours which come *after* each tile:  right, below-left, below, and below-right
+		const cv::Point neighbours[] = { {1, 0}, {-1, 1}, {0, 1}, {1, 1} };
 
-				if (results[rhs_idx].rect.area() == 0 and results[rhs_idx].tile == -1)
+		for (int y = 0; y < rows; y ++)
+		{
+			for (int x = 0; x < columns; x ++)
+			{
+				const auto & lhs_tile = edge_predictions_by_tile[y * columns + x];
+				if (lhs_tile.empty())
 				{
-					// this item has already been consumed and is marked for deletion
 					continue;
 				}
 
-				if (config.only_combine_similar_predictions)
+				for (const auto & offset : neighbours)
 				{
-					// check the probabilities to see if there is any similarity:
-					//
-					// 1) does the LHS contain the best class from the RHS?
-					// 2) does the RHS contain the best class from the LHS?
-					//
-					if (results[lhs_idx].all_probabilities.count(results[rhs_idx].best_class) == 0 and
-						results[rhs_idx].all_probabilities.count(results[lhs_idx].best_class) == 0)
+					const int neighbour_x = x + offset.x;
+					const int neighbour_y = y + offset.y;
+					if (neighbour_x < 0 or neighbour_x >= columns or neighbour_y >= rows)
 					{
-						// the two objects have completely different classes, so we cannot combine them together
 						continue;
 					}
-				}
-
-				const cv::Rect & rhs_rect		= results[rhs_idx].rect;
-				const cv::Rect combined_rect	= lhs_rect | rhs_rect;
-
-				// if this is a good match, then the area of the combined rect will be similar to the area of lhs+rhs
-				const int lhs_area		= lhs_rect		.area();
-				const int rhs_area		= rhs_rect		.area();
-				const int lhs_plus_rhs	= (lhs_area + rhs_area) * config.tile_rect_factor;
-				const int combined_area	= combined_rect	.area();
-
-				if (combined_area <= lhs_plus_rhs)
-				{
-					auto & lhs = results[lhs_idx];
-					auto & rhs = results[rhs_idx];
-
-					lhs.rect = combined_rect;
 
-					lhs.original_point.x = (static_cast<float>(lhs.rect.x) + static_cast<float>(lhs.rect.width	) / 2.0f) / static_cast<float>(mat.cols);
-					lhs.original_point.y = (static_cast<float>(lhs.rect.y) + static_cast<float>(lhs.rect.height	) / 2.0f) / static_cast<float>(mat.rows);
+					for (const auto & rhs_idx : edge_predictions_by_tile[neighbour_y * columns + neighbour_x])
+					{
+						for (const auto & lhs_idx : lhs_tile)
+						{
+							if (is_a_match(results[lhs_idx], results[rhs_idx]))
+							{
+								const size_t lhs_root = find_root(lhs_idx);
+								const size_t rhs_root = find_root(rhs_idx);
+								if (lhs_root < rhs_root)
+								{
+									parent[rhs_root] = lhs_root;
+								}
+								else if (rhs_root < lhs_root)
+								{
+									parent[lhs_root] = rhs_root;
+								}
+							}
+						}
+					}
+				}
+			}
+		}
 
-					lhs.original_size.width		= static_cast<float>(lhs.rect.width	) / static_cast<float>(mat.cols);
-					lhs.original_size.height	= static_cast<float>(lhs.rect.height) / static_cast<float>(mat.rows);
+		// combine every prediction into the root of its set
+		std::vector<bool> needs_new_name(results.size(), false);
+		for (const auto & idx : indexes_of_predictions_near_edges)
+		{
+			const size_t root = find_root(idx);
+			if (root == idx)
+			{
+				continue;
+			}
 
-					// rebuild "all_probabilities" by combining both objects and keeping the max percentage
-					for (auto iter : rhs.all_probabilities)
-					{
-						const auto & key		= iter.first;
-						const auto & rhs_val	= iter.second;
-						const auto & lhs_val	= lhs.all_probabilities[key];
+			auto & lhs = results[root];
+			const auto & rhs = results[idx];
 
-						lhs.all_probabilities[key] = std::max(lhs_val, rhs_val);
-					}
+			lhs.rect |= rhs.rect;
 
-					// come up with a decent + consistent name to use for this object
-					name_prediction(lhs);
+			// rebuild "all_probabilities" by combining both objects and keeping the max percentage
+			for (const auto & iter : rhs.all_probabilities)
+			{
+				const auto & key		= iter.first;
+				const auto & rhs_val	= iter.second;
+				auto & lhs_val			= lhs.all_probabilities[key];
 
-					// mark the RHS to be deleted once we're done looping through all the results
-					rhs.rect = {0, 0, 0, 0};
-					rhs.tile = -1;
-				}
+				lhs_val = std::max(lhs_val, rhs_val);
 			}
+
+			needs_new_name[root] = true;
 		}
 
-		// now go through the results and delete any with an empty rect and tile of -1
-		auto iter = results.begin();
-		while (iter != results.end())
+		// now compact the results in a single pass, keeping only the root of each set
+		size_t number_of_results = 0;
+		for (size_t idx = 0; idx < results.size(); idx ++)
 		{
-			if (iter->rect.area() == 0 and iter->tile == -1)
+			if (find_root(idx) != idx)
 			{
-				// delete this prediction from the results since it has been combined with something else
-				iter = results.erase(iter);
+				// this prediction has been combined with something else
+				continue;
 			}
-			else
+
+			auto & pred = results[idx];
+			if (needs_new_name[idx])
+			{
+				pred.original_point.x		= (static_cast<float>(pred.rect.x) + static_cast<float>(pred.rect.width	) / 2.0f) / static_cast<float>(mat.cols);
+				pred.original_point.y		= (static_cast<float>(pred.rect.y) + static_cast<float>(pred.rect.height) / 2.0f) / static_cast<float>(mat.rows);
+				pred.original_size.width	= static_cast<float>(pred.rect.width	) / static_cast<float>(mat.cols);
+				pred.original_size.height	= static_cast<float>(pred.rect.height	) / static_cast<float>(mat.rows);
+
+				// come up with a decent + consistent name to use for this object
+				name_prediction(pred);
+			}
+
+			if (number_of_results != idx)
 			{
-				iter ++;
+				results[number_of_results] = std::move(pred);
 			}
+			number_of_results ++;
 		}
+		results.resize(number_of_results);
 	}
 
 	if (config.enable_debug)
@@ -736,7 +953,11 @@ DarkHelp::PredictionResults DarkHelp::NN::predict_tile(cv::Mat mat, const float
 		}
 	}
 
+	// each tile has already been limited, but combined together there may still be too many predictions
+	limit_predictions(results);
+
 	original_image			= mat;
+	original_image_size		= mat.size();
 	binary_inverted_image	= cv::Mat();
 	prediction_results		= results;
 	duration				= total_duration;
@@ -749,6 +970,15 @@ DarkHelp::PredictionResults DarkHelp::NN::predict_tile(cv::Mat mat, const float
 
 
 cv::Mat DarkHelp::NN::annotate(const float new_threshold)
+{
+	// start with a new image every time so the images previously returned to the caller are not modified
+	annotated_image = cv::Mat();
+
+	return annotate(annotated_image, cv::Size(0, 0), false, new_threshold);
+}
+
+
+cv::Mat & DarkHelp::NN::annotate(cv::Mat & output, const cv::Size & output_size, const bool in_place, const float new_threshold)
 {
 	if (original_image.empty())
 	{
@@ -761,11 +991,81 @@ cv::Mat DarkHelp::NN::annotate(const float new_threshold)
 		config.threshold = new_threshold;
 	}
 
-	annotated_image = original_image.clone();
+	if (config.lazy_prediction_names)
+	{
+		// we need the labels to annotate the image
+		name_predictions();
+	}
+
+	const bool resize_output = (output_size.area() > 0 and output_size != original_image.size());
+
+	// the predictions may be for a larger image than the one we have if it was decoded at a reduced resolution
+	const cv::Size prediction_size = (original_image_size.area() > 0 ? original_image_size : original_image.size());
+	const bool scale_predictions = (resize_output or prediction_size != original_image.size());
+
+	if (resize_output)
+	{
+		// resize directly into the output image instead of annotating at full size and then resizing the annotated image
+		slow_resize_ignore_aspect_ratio(original_image, output_size, output);
+	}
+	else if (in_place)
+	{
+		output = original_image;
+	}
+	else
+	{
+		// if the output image is already the right size then the memory is re-used
+		original_image.copyTo(output);
+	}
+	annotated_image = output;
+
+	const double horizontal_scale	= static_cast<double>(output.cols) / static_cast<double>(prediction_size.width);
+	const double vertical_scale		= static_cast<double>(output.rows) / static_cast<double>(prediction_size.height);
+	const cv::Rect output_rect(0, 0, output.cols, output.rows);
+
+	// the predictions are always for the original image, so they may need to be scaled to match the output image
+	const auto scale_rect = [&](const cv::Rect & r) -> cv::Rect
+	{
+		if (not scale_predictions)
+		{
+			return r;
+		}
+
+		const cv::Point tl(std::round(r.x * horizontal_scale), std::round(r.y * vertical_scale));
+		const cv::Point br(std::round((r.x + r.width) * horizontal_scale), std::round((r.y + r.height) * vertical_scale));
+
+		return cv::Rect(tl, br) & output_rect;
+	};
+
+	/* The line thickness, the font, and the pixelation size are meant for the full-size image.  When the annotations are
+	 * drawn on a smaller or larger image, they are scaled so the output looks the same as if the full-size image had
+	 * been annotated and then resized.
+	 */
+	const double drawing_scale	= (scale_predictions ? std::min(horizontal_scale, vertical_scale) : 1.0);
+	const auto scale_size		= [&](const int size) { return (size > 0 ? std::max(1, static_cast<int>(std::round(size * drawing_scale))) : size); };
+	const int line_thickness	= scale_size(config.annotation_line_thickness);
+	const int font_thickness	= scale_size(config.annotation_font_thickness);
+	const double font_scale		= config.annotation_font_scale * drawing_scale;
+	const int pixelate_size		= (config.annotation_pixelate_size < 5 ? config.annotation_pixelate_size : std::max(5, scale_size(config.annotation_pixelate_size))); // pixelation needs a minimum size of 5
 
 	if (config.annotation_pixelate_enabled)
 	{
-		pixelate_rectangles(original_image, annotated_image, prediction_results, config.annotation_pixelate_classes, config.annotation_pixelate_size);
+		if (scale_predictions)
+		{
+			VRect rects;
+			for (const auto & pred : prediction_results)
+			{
+				if (config.annotation_pixelate_classes.empty() or config.annotation_pixelate_classes.count(pred.best_class) > 0)
+				{
+					rects.push_back(scale_rect(pred.rect));
+				}
+			}
+			pixelate_rectangles(output, output, rects, pixelate_size, config.annotation_pixelate_mosaic);
+		}
+		else
+		{
+			pixelate_rectangles(original_image, output, prediction_results, config.annotation_pixelate_classes, pixelate_size, config.annotation_pixelate_mosaic);
+		}
 	}
 
 	// make sure we always have colours we can use
@@ -774,34 +1074,123 @@ cv::Mat DarkHelp::NN::annotate(const float new_threshold)
 		config.annotation_colours = get_default_annotation_colours();
 	}
 
-	for (const auto & pred : prediction_results)
+	// labels are normally rendered once and then copied from the cache
+	const bool use_label_cache = (config.annotation_label_cache_size > 0);
+	if (use_label_cache)
+	{
+		labels.set_capacity(config.annotation_label_cache_size);
+
+		// only a few of the most recent durations and timestamps are worth keeping
+		overlay_labels.set_capacity(std::min(config.annotation_label_cache_size, static_cast<size_t>(8)));
+	}
+
+	const auto draw_label = [&](const LabelCache::Label & label, const cv::Rect & r)
 	{
-		if (config.annotation_suppress_classes.count(pred.best_class) != 0)
+		const cv::Rect roi = r & cv::Rect(0, 0, output.cols, output.rows);
+		if (roi.area() > 0)
 		{
-			continue;
+			label.image(roi - r.tl()).copyTo(output(roi));
 		}
+	};
 
-		if (config.annotation_line_thickness > 0 and pred.best_probability >= config.threshold)
+	const auto should_draw = [&](const PredictionResult & pred)
+	{
+		return	config.annotation_suppress_classes.count(pred.best_class) == 0	and
+				config.annotation_line_thickness > 0							and
+				pred.best_probability >= annotation_threshold(pred.best_class);
+	};
+
+	if (config.annotation_shade_predictions > 0.0 and config.annotation_shade_predictions < 1.0)
+	{
+		/* Instead of blending each prediction individually, all the predictions are painted into a colour layer and a
+		 * mask, and then each group of overlapping predictions is blended once.  Blending per group instead of across
+		 * the bounding box of all predictions means small predictions far apart don't cause the whole image to be
+		 * blended.  When predictions overlap, the colour of the last prediction is used.  The buffers are re-used from
+		 * one frame to the next.
+		 */
+		shade_rects		.clear();
+		shade_regions	.clear();
+		for (const auto & pred : prediction_results)
 		{
-			const auto colour = config.annotation_colours[pred.best_class % config.annotation_colours.size()];
+			cv::Rect rect = scale_rect(pred.rect) & output_rect;
+			if (not should_draw(pred))
+			{
+				rect = cv::Rect();
+			}
+			shade_rects.push_back(rect);
 
-			int line_thickness_or_fill = config.annotation_line_thickness;
-			if (config.annotation_shade_predictions >= 1.0)
+			if (rect.area() <= 0)
 			{
-				line_thickness_or_fill = CV_FILLED;
+				continue;
+			}
+
+			// absorb all the existing regions which overlap this rectangle (merging may cause more regions to overlap)
+			cv::Rect region = rect;
+			bool merged = true;
+			while (merged)
+			{
+				merged = false;
+				for (size_t idx = 0; idx < shade_regions.size(); idx ++)
+				{
+					if ((shade_regions[idx] & region).area() > 0)
+					{
+						region |= shade_regions[idx];
+						shade_regions[idx] = shade_regions.back();
+						shade_regions.pop_back();
+						merged = true;
+						break;
+					}
+				}
+			}
+			shade_regions.push_back(region);
+		}
+
+		if (not shade_regions.empty())
+		{
+			cv::Mat & colour_layer	= buffers.mat("shade_colour"	, output.size(), output.type());
+			cv::Mat & mask			= buffers.mat("shade_mask"		, output.size(), CV_8UC1);
+			for (const auto & region : shade_regions)
+			{
+				mask(region).setTo(0);
+			}
+
+			for (size_t idx = 0; idx < prediction_results.size(); idx ++)
+			{
+				const cv::Rect & rect = shade_rects[idx];
+				if (rect.area() > 0)
+				{
+					colour_layer(rect).setTo(config.annotation_colours[prediction_results[idx].best_class % config.annotation_colours.size()]);
+					mask(rect).setTo(255);
+				}
 			}
-			else if (config.annotation_shade_predictions > 0.0)
+
+			const double alpha	= config.annotation_shade_predictions;
+			const double beta	= 1.0 - alpha;
+			cv::Mat & blended	= buffers.mat("shade_blended");
+			for (const auto & region : shade_regions)
 			{
-				cv::Mat roi = annotated_image(pred.rect);
-				cv::Mat coloured_rect(roi.size(), roi.type(), colour);
+				cv::addWeighted(colour_layer(region), alpha, output(region), beta, 0.0, blended);
+				cv::Mat roi = output(region);
+				blended.copyTo(roi, mask(region));
+			}
+		}
+	}
+
+	for (const auto & pred : prediction_results)
+	{
+		if (should_draw(pred))
+		{
+			const auto colour = config.annotation_colours[pred.best_class % config.annotation_colours.size()];
+			const cv::Rect rect = scale_rect(pred.rect);
 
-				const double alpha = config.annotation_shade_predictions;
-				const double beta = 1.0 - alpha;
-				cv::addWeighted(coloured_rect, alpha, roi, beta, 0.0, roi);
+			int line_thickness_or_fill = line_thickness;
+			if (config.annotation_shade_predictions >= 1.0)
+			{
+				line_thickness_or_fill = CV_FILLED;
 			}
 
 //			std::cout << "class id=" << pred.best_class << ", probability=" << pred.best_probability << ", point=(" << pred.rect.x << "," << pred.rect.y << "), name=\"" << pred.name << "\", duration=" << duration_string() << std::endl;
-			cv::rectangle(annotated_image, pred.rect, colour, line_thickness_or_fill);
+			cv::rectangle(output, rect, colour, line_thickness_or_fill);
 
 			if (config.annotation_suppress_all_labels)
 			{
@@ -809,40 +1198,68 @@ cv::Mat DarkHelp::NN::annotate(const float new_threshold)
 			}
 
 			int baseline = 0;
-			const cv::Size text_size = cv::getTextSize(pred.name, config.annotation_font_face, config.annotation_font_scale, config.annotation_font_thickness, &baseline);
+			cv::Size text_size;
+			const LabelCache::Label * label = nullptr;
+			if (use_label_cache)
+			{
+				label		= &labels.get(pred.name, config.annotation_font_face, font_scale, font_thickness, colour, line_thickness, -1, output.type());
+				text_size	= label->text_size;
+				baseline	= label->baseline;
+			}
+			else
+			{
+				text_size = cv::getTextSize(pred.name, config.annotation_font_face, font_scale, font_thickness, &baseline);
+			}
 
 			if (config.annotation_auto_hide_labels)
 			{
-				if (text_size.width >= pred.rect.width or
-					text_size.height >= pred.rect.height)
+				if (text_size.width >= rect.width or
+					text_size.height >= rect.height)
 				{
 					// label is too large to display
 					continue;
 				}
 			}
 
-			cv::Rect r(cv::Point(pred.rect.x - config.annotation_line_thickness/2, pred.rect.y - text_size.height - baseline + config.annotation_line_thickness), cv::Size(text_size.width + config.annotation_line_thickness, text_size.height + baseline));
-			if (r.x < 0) r.x = 0;																			// shift the label to the very left edge of the screen, otherwise it would be off-screen
-			if (r.x + r.width >= annotated_image.cols) r.x = pred.rect.x + pred.rect.width - r.width + 1;	// first attempt at pushing the label to the left
-			if (r.x + r.width >= annotated_image.cols) r.x = annotated_image.cols - r.width;				// more drastic attempt at pushing the label to the left
+			cv::Rect r(cv::Point(rect.x - line_thickness/2, rect.y - text_size.height - baseline + line_thickness), cv::Size(text_size.width + line_thickness, text_size.height + baseline));
+			if (r.x < 0) r.x = 0;														// shift the label to the very left edge of the screen, otherwise it would be off-screen
+			if (r.x + r.width >= output.cols) r.x = rect.x + rect.width - r.width + 1;	// first attempt at pushing the label to the left
+			if (r.x + r.width >= output.cols) r.x = output.cols - r.width;				// more drastic attempt at pushing the label to the left
 
-			if (r.y < 0) r.y = pred.rect.y + pred.rect.height;	// shift the label to the bottom of the prediction, otherwise it would be off-screen
-			if (r.y + r.height >= annotated_image.rows) r.y = pred.rect.y + 1; // shift the label to the inside-top of the prediction (CV seems to have trouble drawing text where the upper bound is y=0, so move it down 1 pixel)
+			if (r.y < 0) r.y = rect.y + rect.height;	// shift the label to the bottom of the prediction, otherwise it would be off-screen
+			if (r.y + r.height >= output.rows) r.y = rect.y + 1; // shift the label to the inside-top of the prediction (CV seems to have trouble drawing text where the upper bound is y=0, so move it down 1 pixel)
 			if (r.y < 0) r.y = 0; // shift the label to the top of the image if it is off-screen
 
-			cv::rectangle(annotated_image, r, colour, CV_FILLED);
-			cv::putText(annotated_image, pred.name, cv::Point(r.x + config.annotation_line_thickness/2, r.y + text_size.height), config.annotation_font_face, config.annotation_font_scale, cv::Scalar(0,0,0), config.annotation_font_thickness, CV_AA);
+			if (label)
+			{
+				draw_label(*label, r);
+			}
+			else
+			{
+				cv::rectangle(output, r, colour, CV_FILLED);
+				cv::putText(output, pred.name, cv::Point(r.x + line_thickness/2, r.y + text_size.height), config.annotation_font_face, font_scale, cv::Scalar(0,0,0), font_thickness, CV_AA);
+			}
 		}
 	}
 
 	if (config.annotation_include_duration)
 	{
-		const std::string str		= duration_string();
-		const cv::Size text_size	= cv::getTextSize(str, config.annotation_font_face, config.annotation_font_scale, config.annotation_font_thickness, nullptr);
+		const std::string str = duration_string();
+
+		if (use_label_cache)
+		{
+			// the cache is keyed on the rendered text, so the label is only rendered again when the duration changes
+			const auto & label = overlay_labels.get(str, config.annotation_font_face, font_scale, font_thickness, cv::Scalar(255,255,255), 2, 2, output.type());
+			draw_label(label, cv::Rect(cv::Point(2, 2), label.image.size()));
+		}
+		else
+		{
+			const cv::Size text_size = cv::getTextSize(str, config.annotation_font_face, font_scale, font_thickness, nullptr);
 
-		cv::Rect r(cv::Point(2, 2), cv::Size(text_size.width + 2, text_size.height + 2));
-		cv::rectangle(annotated_image, r, cv::Scalar(255,255,255), CV_FILLED);
-		cv::putText(annotated_image, str, cv::Point(r.x + 1, r.y + text_size.height), config.annotation_font_face, config.annotation_font_scale, cv::Scalar(0,0,0), config.annotation_font_thickness, CV_AA);
+			cv::Rect r(cv::Point(2, 2), cv::Size(text_size.width + 2, text_size.height + 2));
+			cv::rectangle(output, r, cv::Scalar(255,255,255), CV_FILLED);
+			cv::putText(output, str, cv::Point(r.x + 1, r.y + text_size.height), config.annotation_font_face, font_scale, cv::Scalar(0,0,0), font_thickness, CV_AA);
+		}
 	}
 
 	if (config.annotation_include_timestamp)
@@ -851,14 +1268,23 @@ cv::Mat DarkHelp::NN::annotate(const float new_threshold)
 		char timestamp[100];
 		strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", std::localtime(&tt));
 
-		const cv::Size text_size = cv::getTextSize(timestamp, config.annotation_font_face, config.annotation_font_scale, config.annotation_font_thickness, nullptr);
+		if (use_label_cache)
+		{
+			// the timestamp only changes once per second, so every frame within the same second re-uses the label
+			const auto & label = overlay_labels.get(timestamp, config.annotation_font_face, font_scale, font_thickness, cv::Scalar(255,255,255), 2, 2, output.type());
+			draw_label(label, cv::Rect(cv::Point(2, output.rows - label.text_size.height - 4), label.image.size()));
+		}
+		else
+		{
+			const cv::Size text_size = cv::getTextSize(timestamp, config.annotation_font_face, font_scale, font_thickness, nullptr);
 
-		cv::Rect r(cv::Point(2, annotated_image.rows - text_size.height - 4), cv::Size(text_size.width + 2, text_size.height + 2));
-		cv::rectangle(annotated_image, r, cv::Scalar(255,255,255), CV_FILLED);
-		cv::putText(annotated_image, timestamp, cv::Point(r.x + 1, r.y + text_size.height), config.annotation_font_face, config.annotation_font_scale, cv::Scalar(0,0,0), config.annotation_font_thickness, CV_AA);
+			cv::Rect r(cv::Point(2, output.rows - text_size.height - 4), cv::Size(text_size.width + 2, text_size.height + 2));
+			cv::rectangle(output, r, cv::Scalar(255,255,255), CV_FILLED);
+			cv::putText(output, timestamp, cv::Point(r.x + 1, r.y + text_size.height), config.annotation_font_face, font_scale, cv::Scalar(0,0,0), font_thickness, CV_AA);
+		}
 	}
 
-	return annotated_image;
+	return output;
 }
 
 
@@ -869,32 +1295,10 @@ static inline image convert_opencv_mat_to_darknet_image(cv::Mat mat)
 #endif
 {
 	// this function is taken/inspired directly from Darknet:  image_opencv.cpp, mat_to_image()
+	// but the channel swap, the scaling, and the planar layout are all done in a single pass
 
-	// OpenCV uses BGR, but Darknet expects RGB
-	if (mat.channels() == 3)
-	{
-		cv::Mat rgb;
-		cv::cvtColor(mat, rgb, cv::COLOR_BGR2RGB);
-		mat = rgb;
-	}
-
-	const int width		= mat.cols;
-	const int height	= mat.rows;
-	const int channels	= mat.channels();
-	const int step		= mat.step;
-	image img			= make_image(width, height, channels);
-	uint8_t * data		= (uint8_t*)mat.data;
-
-	for (int y = 0; y < height; ++y)
-	{
-		for (int c = 0; c < channels; ++c)
-		{
-			for (int x = 0; x < width; ++x)
-			{
-				img.data[c*width*height + y*width + x] = data[y*step + x*channels + c] / 255.0f;
-			}
-		}
-	}
+	image img = make_image(mat.cols, mat.rows, mat.channels());
+	DarkHelp::convert_mat_to_planar_rgb(mat, img.data);
 
 	return img;
 }
@@ -962,19 +1366,10 @@ DarkHelp::PredictionResults DarkHelp::NN::predict_internal(cv::Mat mat, const fl
 	// this method is private and cannot be called directly -- instead, see predict()
 
 	clear();
-	original_image = mat;
-
-	if (config.driver == EDriver::kInvalid)
-	{
-		/// @throw std::logic_error if the %DarkHelp object has not been initialized.
-		throw std::logic_error("cannot predict with an uninitialized object");
-	}
+	original_image		= mat;
+	original_image_size	= mat.size();
 
-	if (config.driver == EDriver::kDarknet and darknet_net == nullptr)
-	{
-		/// @throw std::logic_error if the network is invalid.
-		throw std::logic_error("cannot predict with an empty network");
-	}
+	prepare_to_predict(new_threshold);
 
 	if (original_image.empty())
 	{
@@ -982,6 +1377,105 @@ DarkHelp::PredictionResults DarkHelp::NN::predict_internal(cv::Mat mat, const fl
 		throw std::logic_error("cannot predict with an empty image");
 	}
 
+	const auto t1 = std::chrono::high_resolution_clock::now();
+
+	if (config.driver == EDriver::kDarknet)
+	{
+		predict_internal_darknet();
+	}
+	else
+	{
+		predict_internal_opencv();
+	}
+
+	post_process_predictions();
+
+	const auto t2 = std::chrono::high_resolution_clock::now();
+	duration = t2 - t1;
+
+	return prediction_results;
+}
+
+
+std::vector<DarkHelp::PredictionResults> DarkHelp::NN::predict_batch(const std::vector<cv::Mat> & images, const float new_threshold)
+{
+	std::vector<PredictionResults> results(images.size());
+
+	for (const auto & mat : images)
+	{
+		if (mat.empty())
+		{
+			/// @throw std::invalid_argument if any of the images is empty.
+			throw std::invalid_argument("cannot predict with an empty OpenCV image");
+		}
+	}
+
+	clear();
+	prepare_to_predict(new_threshold);
+
+	const size_t batch_size = config.batch_size;
+	std::chrono::high_resolution_clock::duration total_duration = std::chrono::milliseconds(0);
+
+	for (size_t first = 0; first < images.size(); first += batch_size)
+	{
+		const size_t last = std::min(images.size(), first + batch_size);
+
+		// the vectors are members so the memory can be re-used by the next batch
+		batch_images.assign(images.begin() + first, images.begin() + last);
+		batch_results.resize(batch_images.size());
+		for (auto & batch_result : batch_results)
+		{
+			batch_result.clear();
+		}
+
+		const auto t1 = std::chrono::high_resolution_clock::now();
+
+		if (config.driver == EDriver::kDarknet)
+		{
+			predict_internal_darknet_batch(batch_images, batch_results);
+		}
+		else
+		{
+			predict_internal_opencv_batch(batch_images, batch_results);
+		}
+
+		// sorting and snapping is done one image at a time, since snapping needs to look at the original image
+		for (size_t idx = 0; idx < batch_images.size(); idx ++)
+		{
+			original_image			= batch_images[idx];
+			original_image_size		= original_image.size();
+			binary_inverted_image	= cv::Mat();
+			prediction_results		.swap(batch_results[idx]);
+
+			post_process_predictions();
+
+			results[first + idx] = prediction_results;
+		}
+
+		const auto t2 = std::chrono::high_resolution_clock::now();
+		total_duration += t2 - t1;
+	}
+
+	duration = total_duration;
+
+	return results;
+}
+
+
+void DarkHelp::NN::prepare_to_predict(const float new_threshold)
+{
+	if (config.driver == EDriver::kInvalid)
+	{
+		/// @throw std::logic_error if the %DarkHelp object has not been initialized.
+		throw std::logic_error("cannot predict with an uninitialized object");
+	}
+
+	if (config.driver == EDriver::kDarknet and darknet_net == nullptr)
+	{
+		/// @throw std::logic_error if the network is invalid.
+		throw std::logic_error("cannot predict with an empty network");
+	}
+
 	if (new_threshold >= 0.0)
 	{
 		config.threshold = new_threshold;
@@ -1000,15 +1494,59 @@ DarkHelp::PredictionResults DarkHelp::NN::predict_internal(cv::Mat mat, const fl
 		config.threshold = 1.0;
 	}
 
-	const auto t1 = std::chrono::high_resolution_clock::now();
+	if (config.batch_size < 1)
+	{
+		config.batch_size = 1;
+	}
 
-	if (config.driver == EDriver::kDarknet)
+	build_decode_thresholds();
+
+	return;
+}
+
+
+DarkHelp::NN & DarkHelp::NN::build_decode_thresholds()
+{
+	// ignored classes are given a threshold which cannot be reached, so the decode loops need a single comparison per class
+	decode_thresholds.assign(names.size(), config.threshold);
+
+	for (size_t idx = 0; idx < config.class_thresholds.size() and idx < decode_thresholds.size(); idx ++)
 	{
-		predict_internal_darknet();
+		if (config.class_thresholds[idx] >= 0.0f)
+		{
+			decode_thresholds[idx] = config.class_thresholds[idx];
+		}
 	}
-	else
+
+	for (const int idx : config.ignored_classes)
 	{
-		predict_internal_opencv();
+		if (idx >= 0 and static_cast<size_t>(idx) < decode_thresholds.size())
+		{
+			decode_thresholds[idx] = std::numeric_limits<float>::infinity();
+		}
+	}
+
+	lowest_decode_threshold = config.threshold;
+	if (decode_thresholds.empty() == false)
+	{
+		lowest_decode_threshold = *std::min_element(decode_thresholds.begin(), decode_thresholds.end());
+	}
+
+	return *this;
+}
+
+
+void DarkHelp::NN::post_process_predictions()
+{
+	if (config.max_detections > 0)
+	{
+		limit_predictions(prediction_results);
+
+		if (not config.lazy_prediction_names)
+		{
+			// the names were not built during decoding since most of the predictions may have been discarded
+			name_predictions();
+		}
 	}
 
 	if (config.sort_predictions == ESort::kAscending)
@@ -1049,54 +1587,167 @@ DarkHelp::PredictionResults DarkHelp::NN::predict_internal(cv::Mat mat, const fl
 		snap_annotations();
 	}
 
-	const auto t2 = std::chrono::high_resolution_clock::now();
-	duration = t2 - t1;
+	return;
+}
 
-	return prediction_results;
+
+DarkHelp::NN & DarkHelp::NN::limit_predictions(PredictionResults & results)
+{
+	if (config.max_detections > 0 and results.size() > config.max_detections)
+	{
+		std::nth_element(results.begin(), results.begin() + config.max_detections - 1, results.end(),
+				[](const PredictionResult & lhs, const PredictionResult & rhs)
+				{
+					return rhs.best_probability < lhs.best_probability;
+				} );
+		results.resize(config.max_detections);
+	}
+
+	return *this;
 }
 
 
 void DarkHelp::NN::predict_internal_darknet()
 {
-	Darknet::NetworkPtr nw = reinterpret_cast<Darknet::NetworkPtr>(darknet_net);
-
-	cv::Mat resized_image;
-	if (config.use_fast_image_resize)
+	if (config.batch_size > 1)
 	{
-		resized_image = fast_resize_ignore_aspect_ratio(original_image, network_dimensions);
+		// the network expects a full batch of images, so use the batch code with a single image
+		batch_images.assign(1, original_image);
+		batch_results.resize(1);
+		batch_results[0].clear();
+		predict_internal_darknet_batch(batch_images, batch_results);
+		prediction_results.swap(batch_results[0]);
+
+		return;
 	}
-	else
+
+	Darknet::NetworkPtr nw = reinterpret_cast<Darknet::NetworkPtr>(darknet_net);
+
+	const cv::Mat resized_image = resize_to_network(original_image);
+
+	tile_size = network_dimensions;
+
+	// convert into the same buffer every time to avoid allocating a new Darknet image for every frame
+	auto & input = buffers.floats("input", resized_image.total() * resized_image.channels());
+	convert_mat_to_planar_rgb(resized_image, input.data());
+
+	network_predict_ptr(nw, input.data());
+
+	int nboxes = 0;
+	const int use_letterbox = 0;
+	auto darknet_results = get_network_boxes(nw, original_image.cols, original_image.rows, lowest_decode_threshold, config.hierarchy_threshold, 0, 1, &nboxes, use_letterbox);
+
+	decode_darknet_detections(darknet_results, nboxes, original_image.size(), prediction_results);
+
+	free_detections(darknet_results, nboxes);
+
+	return;
+}
+
+
+void DarkHelp::NN::predict_internal_darknet_batch(const std::vector<cv::Mat> & mats, std::vector<PredictionResults> & results)
+{
+	Darknet::NetworkPtr nw = reinterpret_cast<Darknet::NetworkPtr>(darknet_net);
+
+	/* Darknet reads "batch" images worth of floats from the input buffer, even if we don't have that many images to
+	 * process.  So the buffer is always sized for the full batch, and any unused slots at the end are set to zero.
+	 */
+	const int batch_size		= config.batch_size;
+	const size_t image_floats	= static_cast<size_t>(network_dimensions.area()) * number_of_channels;
+	auto & input				= buffers.floats("input", image_floats * batch_size);
+	std::fill(input.begin() + image_floats * mats.size(), input.end(), 0.0f);
+
+	for (size_t idx = 0; idx < mats.size(); idx ++)
 	{
-		resized_image = slow_resize_ignore_aspect_ratio(original_image, network_dimensions);
+		if (mats[idx].channels() != number_of_channels)
+		{
+			/// @throw std::invalid_argument if the number of channels in the image does not match the network.
+			throw std::invalid_argument("image has " + std::to_string(mats[idx].channels()) + " channels but the network expects " + std::to_string(number_of_channels));
+		}
+
+		const cv::Mat resized_image = resize_to_network(mats[idx], idx);
+		convert_mat_to_planar_rgb(resized_image, input.data() + idx * image_floats);
 	}
 
 	tile_size = network_dimensions;
-	DarknetImage img = convert_opencv_mat_to_darknet_image(resized_image);
 
-	network_predict_ptr(nw, img.data);
+	DarknetImage img;
+	img.w		= network_dimensions.width;
+	img.h		= network_dimensions.height;
+	img.c		= number_of_channels;
+	img.data	= input.data();
 
-	int nboxes = 0;
+	// boxes are normalized (relative=1) and we don't letterbox, so the width and height given here don't matter
 	const int use_letterbox = 0;
-	auto darknet_results = get_network_boxes(nw, original_image.cols, original_image.rows, config.threshold, config.hierarchy_threshold, 0, 1, &nboxes, use_letterbox);
+	auto detections = network_predict_batch(nw, img, batch_size, img.w, img.h, lowest_decode_threshold, config.hierarchy_threshold, 0, 1, use_letterbox);
 
-	if (config.non_maximal_suppression_threshold)
+	for (size_t idx = 0; idx < mats.size(); idx ++)
 	{
-		do_nms_sort(darknet_results, nboxes, names.size(), config.non_maximal_suppression_threshold);
+		decode_darknet_detections(detections[idx].dets, detections[idx].num, mats[idx].size(), results[idx]);
 	}
 
-	for (int detection_idx = 0; detection_idx < nboxes; detection_idx ++)
+	free_batch_detections(detections, batch_size);
+
+	return;
+}
+
+
+void DarkHelp::NN::decode_darknet_detections(void * detections, const int number_of_detections, const cv::Size & image_size, PredictionResults & results)
+{
+	auto darknet_results = reinterpret_cast<detection *>(detections);
+
+	if (names.empty() and number_of_detections > 0)
 	{
-		auto & det = darknet_results[detection_idx];
+		// we weren't given a names file to parse, but we know how many classes are defined in the network
+		// so we can invent a few dummy names to use based on the class index
+		for (int i = 0; i < darknet_results[0].classes; i++)
+		{
+			names.push_back("#" + std::to_string(i));
+		}
+		build_decode_thresholds();
+	}
+
+	if (config.non_maximal_suppression_threshold and not config.class_agnostic_nms)
+	{
+		/* Per-class NMS uses the same code as the OpenCV driver.  Every class of every detection which reaches the
+		 * threshold is a candidate, and the probability of each suppressed candidate is set to zero.  This way a
+		 * single detection can still retain multiple classes, the same as it would with Darknet's do_nms_sort().
+		 */
+		auto & candidates = nms_candidates;
+		candidates.clear();
 
-		if (names.empty())
+		for (int detection_idx = 0; detection_idx < number_of_detections; detection_idx ++)
 		{
-			// we weren't given a names file to parse, but we know how many classes are defined in the network
-			// so we can invent a few dummy names to use based on the class index
-			for (int i = 0; i < det.classes; i++)
+			const auto & det = darknet_results[detection_idx];
+			const cv::Rect2d r(det.bbox.x - det.bbox.w / 2.0f, det.bbox.y - det.bbox.h / 2.0f, det.bbox.w, det.bbox.h);
+
+			const int number_of_classes = std::min(det.classes, static_cast<int>(decode_thresholds.size()));
+			for (int class_idx = 0; class_idx < number_of_classes; class_idx ++)
 			{
-				names.push_back("#" + std::to_string(i));
+				if (det.prob[class_idx] >= decode_thresholds[class_idx])
+				{
+					candidates.boxes	.push_back(r);
+					candidates.scores	.push_back(det.prob[class_idx]);
+					candidates.classes	.push_back(class_idx);
+					candidates.rows		.push_back(detection_idx);
+				}
+			}
+		}
+
+		non_maximal_suppression(candidates.boxes, candidates.scores, candidates.classes, config.non_maximal_suppression_threshold, false, &candidates.suppressed_by);
+
+		for (size_t idx = 0; idx < candidates.suppressed_by.size(); idx ++)
+		{
+			if (candidates.suppressed_by[idx] != static_cast<int>(idx))
+			{
+				darknet_results[candidates.rows[idx]].prob[candidates.classes[idx]] = 0.0f;
 			}
 		}
+	}
+
+	for (int detection_idx = 0; detection_idx < number_of_detections; detection_idx ++)
+	{
+		auto & det = darknet_results[detection_idx];
 
 		/* The "det" object has an array called det.prob[].  That array is large enough for 1 entry per class in the network.
 		 * Each entry will be set to 0.0, except for the ones that correspond to the class that was detected.  Note that it
@@ -1108,9 +1759,10 @@ void DarkHelp::NN::predict_internal_darknet()
 		pr.best_class		= 0;
 		pr.best_probability	= 0.0f;
 
-		for (int class_idx = 0; class_idx < det.classes; class_idx ++)
+		const int number_of_classes = std::min(det.classes, static_cast<int>(decode_thresholds.size()));
+		for (int class_idx = 0; class_idx < number_of_classes; class_idx ++)
 		{
-			if (det.prob[class_idx] >= config.threshold)
+			if (det.prob[class_idx] >= decode_thresholds[class_idx])
 			{
 				// remember this probability since it is higher than the threshold
 				pr.all_probabilities[class_idx] = det.prob[class_idx];
@@ -1124,7 +1776,7 @@ void DarkHelp::NN::predict_internal_darknet()
 			}
 		}
 
-		if (pr.best_probability >= config.threshold)
+		if (pr.best_probability > 0.0f)
 		{
 			// at least 1 class is beyond the threshold, so remember this object
 
@@ -1133,30 +1785,82 @@ void DarkHelp::NN::predict_internal_darknet()
 				fix_out_of_bound_normalized_rect(det.bbox.x, det.bbox.y, det.bbox.w, det.bbox.h);
 			}
 
-			const int w = std::round(det.bbox.w * original_image.cols);
-			const int h = std::round(det.bbox.h * original_image.rows);
-			const int x = std::round(det.bbox.x * original_image.cols - w/2.0);
-			const int y = std::round(det.bbox.y * original_image.rows - h/2.0);
+			const int w = std::round(det.bbox.w * image_size.width);
+			const int h = std::round(det.bbox.h * image_size.height);
+			const int x = std::round(det.bbox.x * image_size.width - w/2.0);
+			const int y = std::round(det.bbox.y * image_size.height - h/2.0);
 
 			pr.rect				= cv::Rect(cv::Point(x, y), cv::Size(w, h));
 			pr.original_point	= cv::Point2f(det.bbox.x, det.bbox.y);
 			pr.original_size	= cv::Size2f(det.bbox.w, det.bbox.h);
 
-			// now we come up with a decent name to use for this object
-			name_prediction(pr);
+			// now we come up with a decent name to use for this object (the best class is already known)
+			if (not config.lazy_prediction_names and config.max_detections == 0)
+			{
+				build_prediction_name(pr);
+			}
 
-			prediction_results.push_back(pr);
+			results.push_back(std::move(pr));
 		}
 	}
 
-	free_detections(darknet_results, nboxes);
-	free_image(img);
+	if (config.non_maximal_suppression_threshold and config.class_agnostic_nms)
+	{
+		// class-agnostic NMS also uses the same code as the OpenCV driver
+		fuse_predictions(results, image_size, config.non_maximal_suppression_threshold, ETileFusion::kNMS, true);
+	}
 
 	return;
 }
 
 
+/* Find the highest class probability in a row of the OpenCV output.  Most rows have no class above the threshold, so
+ * this allows the row to be rejected without looking at each class individually.
+ */
+static inline float max_class_probability(const float * ptr, const size_t number_of_classes)
+{
+	size_t idx = 0;
+	float result = 0.0f;
+
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	if (number_of_classes >= 8)
+	{
+		__m128 m0 = _mm_loadu_ps(ptr);
+		__m128 m1 = _mm_loadu_ps(ptr + 4);
+		for (idx = 8; idx + 8 <= number_of_classes; idx += 8)
+		{
+			m0 = _mm_max_ps(m0, _mm_loadu_ps(ptr + idx));
+			m1 = _mm_max_ps(m1, _mm_loadu_ps(ptr + idx + 4));
+		}
+		m0 = _mm_max_ps(m0, m1);
+		m0 = _mm_max_ps(m0, _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(2, 3, 0, 1)));
+		m0 = _mm_max_ps(m0, _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(1, 0, 3, 2)));
+		result = _mm_cvtss_f32(m0);
+	}
+	#endif
+
+	for (; idx < number_of_classes; idx ++)
+	{
+		result = std::max(result, ptr[idx]);
+	}
+
+	return result;
+}
+
+
 void DarkHelp::NN::predict_internal_opencv()
+{
+	batch_images.assign(1, original_image);
+	batch_results.resize(1);
+	batch_results[0].clear();
+	predict_internal_opencv_batch(batch_images, batch_results);
+	prediction_results.swap(batch_results[0]);
+
+	return;
+}
+
+
+void DarkHelp::NN::predict_internal_opencv_batch(const std::vector<cv::Mat> & mats, std::vector<PredictionResults> & results)
 {
 	#ifndef HAVE_OPENCV_DNN_OBJDETECT
 	throw std::runtime_error("OpenCV DNN driver is not supported with this version of OpenCV");
@@ -1164,36 +1868,29 @@ void DarkHelp::NN::predict_internal_opencv()
 
 	const size_t number_of_classes = names.size();
 
-	cv::Mat resized_image;
-	if (config.use_fast_image_resize)
-	{
-		resized_image = fast_resize_ignore_aspect_ratio(original_image, network_dimensions);
-	}
-	else
-	{
-		resized_image = slow_resize_ignore_aspect_ratio(original_image, network_dimensions);
-	}
-
 	tile_size = network_dimensions;
 
 	/* OpenCV images are BGR, but DNN (or maybe specific to Darknet?) requires RGB,
 	 * so make sure to set the "swap" option, otherwise detection won't behave as
 	 * well as expected.
+	 *
+	 * The blob is kept in the buffer pool so OpenCV can re-use the memory from the previous frame.
 	 */
-	auto blob = cv::dnn::blobFromImage(resized_image, 1.0 / 255.0, network_dimensions, {}, /* swapRB=*/true, /* crop=*/false);
-	opencv_net.setInput(blob);
-
-	/* Get the names of all the layers we're interested in (should start with "yolo_").
-	 * This is important!  We're going to have to combine the results from all these layers.
-	 */
-	VStr yolo_layer_names;
-	for (const auto & name : opencv_net.getLayerNames())
+	cv::Mat & blob = buffers.mat("blob");
+	if (mats.size() == 1)
+	{
+		cv::dnn::blobFromImage(resize_to_network(mats[0]), blob, 1.0 / 255.0, network_dimensions, {}, /* swapRB=*/true, /* crop=*/false);
+	}
+	else
 	{
-		if (name.find("yolo_") == 0)
+		resized_images.resize(mats.size());
+		for (size_t idx = 0; idx < mats.size(); idx ++)
 		{
-			yolo_layer_names.push_back(name);
+			resized_images[idx] = resize_to_network(mats[idx], idx);
 		}
+		cv::dnn::blobFromImages(resized_images, blob, 1.0 / 255.0, network_dimensions, {}, /* swapRB=*/true, /* crop=*/false);
 	}
+	opencv_net.setInput(blob);
 
 	/* The output mat is float and will have thousands of rows.
 	 * Each row has the following fields, each of which is a "float":
@@ -1208,42 +1905,69 @@ void DarkHelp::NN::predict_internal_opencv()
 	 *		% class 3 ...etc...
 	 *
 	 * For every class, another field with the probability for that class.
+	 *
+	 * When more than 1 image is in the blob, the output is normally a 3D mat of [images, rows, fields], so the image
+	 * index is used as the first dimension when looking up a row.  If instead the output is a 2D mat, then the rows for
+	 * each image are stored one after the other, so the first 1/N rows belong to the first image, the next 1/N rows
+	 * belong to the 2nd image, etc.
 	 */
-	std::vector<std::vector<cv::Mat>> output_mats;
 	opencv_net.forward(output_mats, yolo_layer_names);
 
 	/* To get the final output to behave/look as similar as we can to the original
 	 * darknet results, we'll need to refer back to the OpenCV results as we build
-	 * up the results vector.  For this reason, we need to know where in the matrix
-	 * to look up the individual results.
+	 * up the results vector.  For this reason, each candidate remembers which YOLO
+	 * output and which row in the matrix it came from.
 	 */
-	struct Lookup
+	for (size_t image_idx = 0; image_idx < mats.size(); image_idx ++)
 	{
-		size_t	idx; // each of the YOLO layer will have an entry in "output_mats"
-		int		row; // cv::Mat rows is of type "int", not size_t
-	};
-	using VLookups = std::vector<Lookup>;
-
-	std::vector<VRect2d>	boxes	(number_of_classes);
-	std::vector<VFloat>		scores	(number_of_classes);
-	std::vector<VLookups>	lookups	(number_of_classes);
+		const cv::Size image_size = mats[image_idx].size();
 
-	for (size_t output_idx = 0; output_idx < yolo_layer_names.size(); output_idx ++)
-	{
-		cv::Mat & output = output_mats[output_idx][0];
-		if (config.enable_debug)
+		// get a pointer to the 1st float of a row, which works with both 2D and 3D output mats
+		const auto row_pointer = [&image_idx](cv::Mat & output, const int row)
 		{
-			std::cout << "Layer \"" << yolo_layer_names[output_idx] << "\":" << std::endl;
-		}
+			if (output.dims == 3)
+			{
+				return output.ptr<float>(static_cast<int>(image_idx), row);
+			}
+			return output.ptr<float>(row);
+		};
+
+		// all the candidates are stored one after the other, re-using the memory from the previous frame
+		auto & candidates = nms_candidates;
+		candidates.clear();
 
-		for (int row = 0; row < output.rows; row ++)
+		for (size_t output_idx = 0; output_idx < yolo_layer_names.size(); output_idx ++)
 		{
-			// get a pointer to the 1st float for this row, which we easily increment to get all the floats
-			const float * const ptr = output.ptr<float>(row);
+			cv::Mat & output = output_mats[output_idx][0];
+			if (config.enable_debug)
+			{
+				std::cout << "Layer \"" << yolo_layer_names[output_idx] << "\":" << std::endl;
+			}
 
-			// [4] is the "objectness"
-			if (ptr[4] >= 0.01f)
+			int rows_per_image	= 0;
+			int first_row		= 0;
+			if (output.dims == 3)
 			{
+				// the 1st dimension is the image, and the rows for that image always start at zero
+				rows_per_image	= output.size[1];
+			}
+			else
+			{
+				rows_per_image	= output.rows / static_cast<int>(mats.size());
+				first_row		= rows_per_image * static_cast<int>(image_idx);
+			}
+
+			for (int row = first_row; row < first_row + rows_per_image; row ++)
+			{
+				// get a pointer to the 1st float for this row, which we easily increment to get all the floats
+				const float * const ptr = row_pointer(output, row);
+
+				// [4] is the "objectness", and most rows can be skipped with this single comparison
+				if (ptr[4] < config.objectness_threshold)
+				{
+					continue;
+				}
+
 				// *** DEBUG ***
 				if (config.enable_debug)
 				{
@@ -1272,6 +1996,12 @@ void DarkHelp::NN::predict_internal_opencv()
 				}
 				// *** DEBUG ***
 
+				// if not a single class reaches the threshold, then there is no need to look at the individual classes
+				if (max_class_probability(ptr + 5, number_of_classes) < lowest_decode_threshold)
+				{
+					continue;
+				}
+
 				const float & cx	= ptr[0];
 				const float & cy	= ptr[1];
 				const float & w		= ptr[2];
@@ -1286,106 +2016,98 @@ void DarkHelp::NN::predict_internal_opencv()
 				for (size_t c = 0; c < number_of_classes; c++)
 				{
 					const auto & confidence = ptr[5 + c];
-					if (confidence >= config.threshold)
+					if (confidence >= decode_thresholds[c])
 					{
-						lookups	[c].push_back({output_idx, row});
-						boxes	[c].push_back(r);
-						scores	[c].push_back(confidence);
+						candidates.boxes	.push_back(r);
+						candidates.scores	.push_back(confidence);
+						candidates.classes	.push_back(static_cast<int>(c));
+						candidates.outputs	.push_back(static_cast<int>(output_idx));
+						candidates.rows		.push_back(row);
 					}
 				}
 			}
 		}
-	}
 
-	// This is where we run non maximal suppression, which tells us which indices we need to keep.
-	// We'll take the output of NMS and keep track of all the mat rows which need to be in the results.
-	VLookups rows_of_interest;
-	for (size_t c = 0; c < number_of_classes; c++)
-	{
-		VInt indices;
-		cv::dnn::NMSBoxes(boxes[c], scores[c], 0.0, config.non_maximal_suppression_threshold, indices);
-
-		for (const auto & i : indices)
-		{
-			rows_of_interest.push_back(lookups[c][i]);
-		}
+		// This is where we run non maximal suppression, which tells us which indices we need to keep.  All the classes
+		// are handled in a single call, and we keep track of all the mat rows which need to be in the results.
+		const VInt indices = non_maximal_suppression(candidates.boxes, candidates.scores, candidates.classes, config.non_maximal_suppression_threshold, config.class_agnostic_nms);
 
 		// *** DEBUG ***
 		if (config.enable_debug)
 		{
-			if (boxes[c].size() > 0 or indices.size() > 0)
+			std::cout << "-> " << candidates.scores.size() << " candidates";
+			if (indices.size() != candidates.scores.size())
 			{
-				std::cout << "-> class #" << c << " (" << names.at(c) << ") contains " << boxes[c].size() << " entries";
-				if (indices.size() != boxes[c].size())
-				{
-					std::cout << " but NMS returned " << indices.size() << " indices";
-				}
-				std::cout << ":";
-				for (const auto & i : indices)
-				{
-					std::cout << " " << i << "=[" << lookups[c][i].idx << "," << lookups[c][i].row << "]";
-				}
-				std::cout << std::endl;
+				std::cout << " but NMS returned " << indices.size() << " indices";
 			}
+			std::cout << ":";
+			for (const auto & idx : indices)
+			{
+				std::cout << " " << idx << "=[" << candidates.outputs[idx] << "," << candidates.rows[idx] << "," << names.at(candidates.classes[idx]) << "]";
+			}
+			std::cout << std::endl;
 		}
 		// *** DEBUG ***
-	}
 
-	// now iterate through just those indexes returned by NMS and build the DarkHelp-style results
-	for (const auto iter : rows_of_interest)
-	{
-		const auto & output_idx	= iter.idx;
-		const auto & row		= iter.row;
+		// now iterate through just those indexes returned by NMS and build the DarkHelp-style results
+		for (const auto idx : indices)
+		{
+			const size_t output_idx	= candidates.outputs[idx];
+			const int row			= candidates.rows[idx];
 
-		cv::Mat & output = output_mats[output_idx][0];
-		float * ptr	= output.ptr<float>(row);
+			cv::Mat & output = output_mats[output_idx][0];
+			float * ptr	= row_pointer(output, row);
 
-		PredictionResult pr;
-		pr.tile				= 0;
-		pr.best_class		= 0;
-		pr.best_probability	= 0.0f;
-
-		// loop through all of the classes this could be and see if we can find something we can use
-		for (size_t c = 0; c < number_of_classes; c++)
-		{
-			const float & probability = ptr[5 + c];
+			PredictionResult pr;
+			pr.tile				= 0;
+			pr.best_class		= 0;
+			pr.best_probability	= 0.0f;
 
-			if (probability >= config.threshold)
+			// loop through all of the classes this could be and see if we can find something we can use
+			for (size_t c = 0; c < number_of_classes; c++)
 			{
-				if (probability > pr.best_probability)
+				const float & probability = ptr[5 + c];
+
+				if (probability >= decode_thresholds[c])
 				{
-					pr.best_class = c;
-					pr.best_probability = probability;
-				}
+					if (probability > pr.best_probability)
+					{
+						pr.best_class = c;
+						pr.best_probability = probability;
+					}
 
-				pr.all_probabilities[c] = probability;
+					pr.all_probabilities[c] = probability;
+				}
 			}
-		}
 
-		if (pr.best_probability > 0.0f)
-		{
-			float & cx	= ptr[0];
-			float & cy	= ptr[1];
-			float & w	= ptr[2];
-			float & h	= ptr[3];
-
-			if (config.fix_out_of_bound_values)
+			if (pr.best_probability > 0.0f)
 			{
-				fix_out_of_bound_normalized_rect(cx, cy, w, h);
-			}
+				float & cx	= ptr[0];
+				float & cy	= ptr[1];
+				float & w	= ptr[2];
+				float & h	= ptr[3];
+
+				if (config.fix_out_of_bound_values)
+				{
+					fix_out_of_bound_normalized_rect(cx, cy, w, h);
+				}
 
-			const int new_w = std::round(original_image.cols * w				);
-			const int new_h = std::round(original_image.rows * h				);
-			const int new_x = std::round(original_image.cols * (cx - w / 2.0f)	);
-			const int new_y = std::round(original_image.rows * (cy - h / 2.0f)	);
+				const int new_w = std::round(image_size.width	* w				);
+				const int new_h = std::round(image_size.height	* h				);
+				const int new_x = std::round(image_size.width	* (cx - w / 2.0f)	);
+				const int new_y = std::round(image_size.height	* (cy - h / 2.0f)	);
 
-			pr.rect				= cv::Rect(cv::Point(new_x, new_y), cv::Size(new_w, new_h));
-			pr.original_point	= cv::Point2f(cx, cy);
-			pr.original_size	= cv::Size2f(w, h);
+				pr.rect				= cv::Rect(cv::Point(new_x, new_y), cv::Size(new_w, new_h));
+				pr.original_point	= cv::Point2f(cx, cy);
+				pr.original_size	= cv::Size2f(w, h);
 
-			name_prediction(pr);
+				if (not config.lazy_prediction_names and config.max_detections == 0)
+				{
+					build_prediction_name(pr);
+				}
 
-			prediction_results.push_back(pr);
+				results[image_idx].push_back(std::move(pr));
+			}
 		}
 	}
 
@@ -1395,12 +2117,58 @@ void DarkHelp::NN::predict_internal_opencv()
 }
 
 
+cv::Mat DarkHelp::NN::resize_to_network(const cv::Mat & mat, const size_t index)
+{
+	if (mat.size() == network_dimensions)
+	{
+		// nothing to do, the image is already the right size
+		return mat;
+	}
+
+	cv::Mat & dst = buffers.mat("resized", index);
+	if (config.use_fast_image_resize)
+	{
+		fast_resize_ignore_aspect_ratio(mat, network_dimensions, dst);
+	}
+	else
+	{
+		slow_resize_ignore_aspect_ratio(mat, network_dimensions, dst);
+	}
+
+	return dst;
+}
+
+
+size_t DarkHelp::NN::reallocation_count() const
+{
+	return buffers.reallocation_count();
+}
+
+
 DarkHelp::NN & DarkHelp::NN::name_prediction(PredictionResult & pred)
+{
+	find_best_class(pred);
+
+	if (config.lazy_prediction_names)
+	{
+		// the name will be built later if it is needed, see name_predictions()
+		pred.name.clear();
+	}
+	else
+	{
+		build_prediction_name(pred);
+	}
+
+	return *this;
+}
+
+
+DarkHelp::NN & DarkHelp::NN::find_best_class(PredictionResult & pred)
 {
 	pred.best_class = 0;
 	pred.best_probability = 0.0f;
 
-	for (auto iter : pred.all_probabilities)
+	for (const auto & iter : pred.all_probabilities)
 	{
 		const auto & key = iter.first;
 		const auto & val = iter.second;
@@ -1412,27 +2180,49 @@ DarkHelp::NN & DarkHelp::NN::name_prediction(PredictionResult & pred)
 		}
 	}
 
-	pred.name = names.at(pred.best_class);
-	if (config.names_include_percentage)
+	return *this;
+}
+
+
+float DarkHelp::NN::annotation_threshold(const int class_idx) const
+{
+	if (class_idx >= 0 and static_cast<size_t>(class_idx) < config.class_thresholds.size() and config.class_thresholds[class_idx] >= 0.0f)
 	{
-		const int percentage = std::round(100.0 * pred.best_probability);
-		pred.name += " " + std::to_string(percentage) + "%";
+		return config.class_thresholds[class_idx];
 	}
 
+	return config.threshold;
+}
+
+
+DarkHelp::NN & DarkHelp::NN::build_prediction_name(PredictionResult & pred)
+{
+	const auto append_percentage = [&](const float probability)
+	{
+		if (config.names_include_percentage)
+		{
+			const int percentage = std::round(100.0 * probability);
+			pred.name += ' ';
+			pred.name += std::to_string(percentage);
+			pred.name += '%';
+		}
+	};
+
+	// assign() and append() re-use the existing string capacity instead of creating temporary strings
+	pred.name.assign(names.at(pred.best_class));
+	append_percentage(pred.best_probability);
+
 	if (config.include_all_names and pred.all_probabilities.size() > 1)
 	{
 		// we have multiple probabilities!
-		for (auto iter : pred.all_probabilities)
+		for (const auto & iter : pred.all_probabilities)
 		{
 			const int & key = iter.first;
 			if (key != pred.best_class)
 			{
-				pred.name += ", " + names.at(key);
-				if (config.names_include_percentage)
-				{
-					const int percentage = std::round(100.0 * iter.second);
-					pred.name += " " + std::to_string(percentage) + "%";
-				}
+				pred.name.append(", ");
+				pred.name.append(names.at(key));
+				append_percentage(iter.second);
 			}
 		}
 	}
@@ -1441,17 +2231,196 @@ DarkHelp::NN & DarkHelp::NN::name_prediction(PredictionResult & pred)
 }
 
 
-DarkHelp::NN & DarkHelp::NN::snap_annotations()
+DarkHelp::NN & DarkHelp::NN::name_predictions()
 {
 	for (auto & pred : prediction_results)
 	{
-		snap_annotation(pred);
+		if (pred.name.empty())
+		{
+			build_prediction_name(pred);
+		}
+	}
+
+	return *this;
+}
+
+
+DarkHelp::NN & DarkHelp::NN::snap_annotations()
+{
+	if (config.snapping_limit_shrink	>= 1.0f and	// cannot shrink
+		config.snapping_limit_grow		<= 1.0f)	// cannot grow
+	{
+		// nothing we can do with snapping, so don't bother thresholding the image
+		return *this;
+	}
+
+	// threshold the area around every annotation first, so the integral image only needs to be built once
+	for (const auto & pred : prediction_results)
+	{
+		prepare_snapping_region(pred.rect);
+	}
+	build_snapping_integral();
+
+	if (config.snapping_in_parallel and prediction_results.size() > 1)
+	{
+		// each annotation only reads the thresholded image and writes to its own prediction, so the results are the same
+		cv::parallel_for_(cv::Range(0, prediction_results.size()),
+				[&](const cv::Range & range)
+				{
+					for (int idx = range.start; idx < range.end; idx ++)
+					{
+						snap_prepared_annotation(prediction_results[idx]);
+					}
+				} );
+	}
+	else
+	{
+		for (auto & pred : prediction_results)
+		{
+			snap_prepared_annotation(pred);
+		}
 	}
 
 	return *this;
 }
 
 
+cv::Rect DarkHelp::NN::snapping_region(const cv::Rect & rect) const
+{
+	const cv::Rect image_rect(0, 0, original_image.cols, original_image.rows);
+
+	if (not config.snapping_limit_region)
+	{
+		// the annotations may snap to anything in the image
+		return image_rect;
+	}
+
+	/* Snapping stops once the area has grown beyond the limit, so the rectangle cannot grow by more than this in any
+	 * direction unless it is also shrinking in the other direction.  Snapping is not allowed to go beyond this region.
+	 */
+	const float grow = std::max(0.0f, config.snapping_limit_grow - 1.0f);
+	const int hmargin = config.snapping_horizontal_tolerance	+ std::ceil(grow * rect.width	);
+	const int vmargin = config.snapping_vertical_tolerance		+ std::ceil(grow * rect.height	);
+
+	cv::Rect region(rect.x - hmargin, rect.y - vmargin, rect.width + 2 * hmargin, rect.height + 2 * vmargin);
+
+	return region & image_rect;
+}
+
+
+DarkHelp::NN & DarkHelp::NN::prepare_snapping_region(const cv::Rect & rect)
+{
+	if (binary_inverted_image.empty())
+	{
+		// this is a new image, so forget about all the regions from the previous image
+		binary_inverted_image = buffers.mat("snap_binary", original_image.size(), CV_8UC1);
+		binary_inverted_image.setTo(0);
+		snapping_regions.clear();
+		snapping_bounds = cv::Rect();
+	}
+
+	const cv::Rect region = snapping_region(rect);
+	if (region.area() <= 0)
+	{
+		return *this;
+	}
+
+	for (const auto & r : snapping_regions)
+	{
+		if ((r & region) == region)
+		{
+			// this area has already been thresholded
+			return *this;
+		}
+	}
+
+	/* The adaptive threshold looks at a block of pixels around each pixel, so the greyscale image needs to include
+	 * enough pixels around the region to get exactly the same results as if the entire image had been thresholded.
+	 */
+	const int border = config.binary_threshold_block_size / 2 + 1;
+	const cv::Rect padded = cv::Rect(region.x - border, region.y - border, region.width + 2 * border, region.height + 2 * border) & cv::Rect(0, 0, original_image.cols, original_image.rows);
+
+	cv::Mat & greyscale = buffers.mat("snap_greyscale");
+	cv::Mat & threshold = buffers.mat("snap_threshold");
+	cv::cvtColor(original_image(padded), greyscale, cv::COLOR_BGR2GRAY);
+	cv::adaptiveThreshold(greyscale, threshold, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY_INV, config.binary_threshold_block_size, config.binary_threshold_constant);
+	threshold(region - padded.tl()).copyTo(binary_inverted_image(region));
+
+	snapping_regions.push_back(region);
+	snapping_bounds = (snapping_bounds.area() > 0 ? (snapping_bounds | region) : region);
+	snapping_integral = cv::Mat();
+
+	return *this;
+}
+
+
+DarkHelp::NN & DarkHelp::NN::build_snapping_integral()
+{
+	if (snapping_integral.empty() and snapping_bounds.area() > 0)
+	{
+		/* Build an integral image of the non-zero pixels within the thresholded regions.  This is a count of pixels
+		 * rather than the usual sum of pixel values since the binary image uses 255, which could overflow on very
+		 * large images.
+		 */
+		snapping_integral = buffers.mat("snap_integral", cv::Size(snapping_bounds.width + 1, snapping_bounds.height + 1), CV_32SC1);
+		int * previous = snapping_integral.ptr<int>(0);
+		std::fill(previous, previous + snapping_integral.cols, 0);
+
+		for (int y = 0; y < snapping_bounds.height; y ++)
+		{
+			const uint8_t * src = binary_inverted_image.ptr<uint8_t>(snapping_bounds.y + y) + snapping_bounds.x;
+			int * current = snapping_integral.ptr<int>(y + 1);
+			current[0] = 0;
+
+			int row_count = 0;
+			for (int x = 0; x < snapping_bounds.width; x ++)
+			{
+				row_count += (src[x] ? 1 : 0);
+				current[x + 1] = previous[x + 1] + row_count;
+			}
+			previous = current;
+		}
+	}
+
+	return *this;
+}
+
+
+cv::Rect DarkHelp::NN::find_snapping_rect(const cv::Rect & roi) const
+{
+	// coordinates are relative to the integral image
+	const int x1 = roi.x - snapping_bounds.x;
+	const int y1 = roi.y - snapping_bounds.y;
+	const int x2 = x1 + roi.width;
+	const int y2 = y1 + roi.height;
+
+	const auto count = [&](const int left, const int top, const int right, const int bottom)
+	{
+		return	snapping_integral.at<int>(bottom	, right	)
+			-	snapping_integral.at<int>(top		, right	)
+			-	snapping_integral.at<int>(bottom	, left	)
+			+	snapping_integral.at<int>(top		, left	);
+	};
+
+	if (roi.area() <= 0 or count(x1, y1, x2, y2) == 0)
+	{
+		// same as calling cv::boundingRect() with no points
+		return cv::Rect(roi.x, roi.y, 0, 0);
+	}
+
+	int top		= y1;
+	int bottom	= y2;
+	int left	= x1;
+	int right	= x2;
+	while (count(x1, top		, x2, top + 1	) == 0) top		++;
+	while (count(x1, bottom - 1	, x2, bottom	) == 0) bottom	--;
+	while (count(left	, top, left + 1	, bottom) == 0) left	++;
+	while (count(right - 1, top, right	, bottom) == 0) right	--;
+
+	return cv::Rect(snapping_bounds.x + left, snapping_bounds.y + top, right - left, bottom - top);
+}
+
+
 DarkHelp::NN & DarkHelp::NN::snap_annotation(DarkHelp::PredictionResult & pred)
 {
 	if (config.snapping_limit_shrink	>= 1.0f and	// cannot shrink
@@ -1461,13 +2430,27 @@ DarkHelp::NN & DarkHelp::NN::snap_annotation(DarkHelp::PredictionResult & pred)
 		return *this;
 	}
 
-	if (binary_inverted_image.empty())
+	// only the area around the annotation is thresholded (this does nothing if the area has already been thresholded)
+	prepare_snapping_region(pred.rect);
+	build_snapping_integral();
+	snap_prepared_annotation(pred);
+
+	return *this;
+}
+
+
+void DarkHelp::NN::snap_prepared_annotation(DarkHelp::PredictionResult & pred) const
+{
+	if (config.snapping_limit_shrink	>= 1.0f and	// cannot shrink
+		config.snapping_limit_grow		<= 1.0f)	// cannot grow
+	{
+		return;
+	}
+
+	const cv::Rect region = snapping_region(pred.rect);
+	if (region.area() <= 0)
 	{
-		cv::Mat greyscale;
-		cv::Mat threshold;
-		cv::cvtColor(original_image, greyscale, cv::COLOR_BGR2GRAY);
-		cv::adaptiveThreshold(greyscale, threshold, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY, config.binary_threshold_block_size, config.binary_threshold_constant);
-		binary_inverted_image = ~ threshold;
+		return;
 	}
 
 	const auto original_rect	= pred.rect;
@@ -1531,13 +2514,10 @@ DarkHelp::NN & DarkHelp::NN::snap_annotation(DarkHelp::PredictionResult & pred)
 			roi.height = binary_inverted_image.rows - roi.y;
 		}
 
-		cv::Mat nonzero;
-		cv::findNonZero(binary_inverted_image(roi), nonzero);
-		auto new_rect = cv::boundingRect(nonzero);
+		// this does nothing unless snapping_limit_region has been enabled
+		roi &= region;
 
-		// note that new_rect is relative to the RoI, so we need to move it back into the full image coordinate space
-		new_rect.x += roi.x;
-		new_rect.y += roi.y;
+		const auto new_rect = find_snapping_rect(roi);
 
 		if (new_rect == final_rect)
 		{
@@ -1604,7 +2584,7 @@ DarkHelp::NN & DarkHelp::NN::snap_annotation(DarkHelp::PredictionResult & pred)
 		}
 	}
 
-	return *this;
+	return;
 }
 
 
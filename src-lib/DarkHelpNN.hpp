@@ -254,6 +254,21 @@ namespace DarkHelp
 			 */
 			PredictionResults predict(cv::Mat mat, const float new_threshold = -1.0f);
 
+			/** Similar to the other @ref DarkHelp::NN::predict() calls, but for an image which has been decoded at a reduced
+			 * resolution, such as by @ref DarkHelp::read_image().  The predictions are scaled back to @p original_size, so
+			 * they describe the image at full resolution.
+			 *
+			 * @param [in] mat The reduced image.  The member @ref DarkHelp::NN::original_image will be set to this image.
+			 * @param [in] original_size The size of the image at full resolution.  The member
+			 * @ref DarkHelp::NN::original_image_size will be set to this size.
+			 * @param [in] new_threshold See the other @ref DarkHelp::NN::predict() calls.
+			 *
+			 * @see @ref DarkHelp::Config::reduced_resolution_decode
+			 *
+			 * @since 2026-10-17
+			 */
+			PredictionResults predict_reduced(cv::Mat mat, const cv::Size & original_size, const float new_threshold = -1.0f);
+
 #ifdef DARKHELP_CAN_INCLUDE_DARKNET
 			/** Use the neural network to predict what is contained in this image.    This results in a call to either
 			 * @ref DarkHelp::NN::predict_internal() or @ref DarkHelp::NN::predict_tile() depending on how
@@ -298,6 +313,26 @@ namespace DarkHelp
 			 */
 			PredictionResults predict_tile(cv::Mat mat, const float new_threshold = -1.0f);
 
+			/** Use the neural network to predict what is contained in several images at once.  The images are grouped
+			 * together in batches of @ref DarkHelp::Config::batch_size images, and each batch is sent to the network in a
+			 * single call.  With a GPU this is normally much faster than calling @ref DarkHelp::NN::predict() once per image.
+			 *
+			 * The results are returned in the same order as the images.  Once this call returns,
+			 * @ref DarkHelp::NN::original_image and @ref DarkHelp::NN::prediction_results describe the @em last image, while
+			 * @ref DarkHelp::NN::duration is the total time needed to process all of the images.
+			 *
+			 * @note Tiling is not applied to the images passed to this method.
+			 *
+			 * @param [in] images The images to analyze.  None of the images may be empty.
+			 * @param [in] new_threshold Which threshold to use.  If less than zero, the previous threshold will be applied.
+			 *
+			 * @see @ref DarkHelp::Config::batch_size
+			 * @see @ref DarkHelp::NN::predict()
+			 *
+			 * @since 2026-10-17
+			 */
+			std::vector<PredictionResults> predict_batch(const std::vector<cv::Mat> & images, const float new_threshold = -1.0f);
+
 			/** Takes the most recent @ref DarkHelp::NN::prediction_results, and applies them to the most recent
 			 * @ref DarkHelp::NN::original_image.  The output annotated image is stored in @ref DarkHelp::NN::annotated_image
 			 * as well as returned to the caller.
@@ -334,12 +369,65 @@ namespace DarkHelp
 			 */
 			cv::Mat annotate(const float new_threshold = -1.0f);
 
+			/** Same as the other @ref DarkHelp::NN::annotate(), but the annotations are drawn into an image owned by the
+			 * caller.  When @p output is already the correct size and type, the memory is re-used instead of allocating
+			 * a new image for every frame.  @ref DarkHelp::NN::annotated_image will refer to the same image as @p output.
+			 *
+			 * @param [out] output The image into which the annotations are drawn.
+			 * @param [in] output_size If set, @ref DarkHelp::NN::original_image is resized to exactly this size and the
+			 * annotations are then drawn at that size.  This is much faster than annotating at full size and resizing
+			 * the annotated image.  The line thickness, the font scale and thickness, and the pixelation size are scaled
+			 * by the same amount as the image, so the results look the same as if the full-size image had been annotated
+			 * and then resized.  The aspect ratio is not preserved, see @ref DarkHelp::size_keeping_aspect_ratio().
+			 * @param [in] in_place When set to @p true and the image is not being resized, the annotations are drawn
+			 * directly on @ref DarkHelp::NN::original_image instead of a copy.  This means the original image is modified.
+			 * @param [in] new_threshold See the other @ref DarkHelp::NN::annotate().
+			 *
+			 * For example, to annotate video frames at a smaller resolution without allocating a new image every frame:
+			 *
+			 * ~~~~
+			 * cv::Mat annotated;
+			 * while (video.read(frame))
+			 * {
+			 *     nn.predict(frame);
+			 *     nn.annotate(annotated, cv::Size(640, 480));
+			 *     output.write(annotated);
+			 * }
+			 * ~~~~
+			 *
+			 * @since 2026-10-17
+			 */
+			cv::Mat & annotate(cv::Mat & output, const cv::Size & output_size = cv::Size(0, 0), const bool in_place = false, const float new_threshold = -1.0f);
+
 			/** Return @ref DarkHelp::NN::duration as a text string which can then be added to the image during annotation.
 			 * For example, this might return @p "912 microseconds" or @p "375 milliseconds".
 			 * @see @ref DarkHelp::NN::annotate()
 			 */
 			std::string duration_string();
 
+			/** The number of times one of the working buffers in @ref DarkHelp::BufferPool has been re-allocated, such as the
+			 * resized image, the Darknet input, and the OpenCV blob.  Once the first frame has been processed, this value
+			 * should no longer change so long as the images remain the same size.
+			 *
+			 * @note This only counts the buffers in the pool.  It is not a count of every heap allocation.  Memory allocated
+			 * within Darknet or OpenCV's DNN module is not included, nor is the memory needed for the results, such as the
+			 * @ref DarkHelp::PredictionResults returned to the caller, the prediction names, and the indices returned by
+			 * non-maximal suppression.
+			 *
+			 * @see @ref DarkHelp::BufferPool
+			 *
+			 * @since 2026-10-17
+			 */
+			size_t reallocation_count() const;
+
+			/** Build the label text for every prediction in @ref DarkHelp::NN::prediction_results which doesn't yet have a
+			 * name.  This is only needed when @ref DarkHelp::Config::lazy_prediction_names has been enabled, since otherwise
+			 * the names are built during prediction.  @ref DarkHelp::NN::annotate() calls this automatically.
+			 *
+			 * @since 2026-10-17
+			 */
+			NN & name_predictions();
+
 			/// Determine the size of the network.  For example, 416x416, or 608x480.
 			cv::Size network_size();
 
@@ -351,7 +439,7 @@ namespace DarkHelp
 			 * you can manually invoke this method to get the annotations to snap, or you can also
 			 * manually call @ref DarkHelp::NN::snap_annotation() on specific annotations as needed.
 			 *
-			 * @note This can be expensive to run depending on the image dimensions, the image threshold
+			 * @note This can be expensive to run depending on the size of the annotations, the image threshold
 			 * limits, and the amount of "snapping" required for each annotation since the process of "snapping"
 			 * is iterative and requires looking for blank spaces within the image.
 			 *
@@ -431,10 +519,21 @@ namespace DarkHelp
 			/// The most recent image handled by @ref DarkHelp::NN::predict().
 			cv::Mat original_image;
 
+			/** The size of the image described by @ref DarkHelp::NN::prediction_results.  This is the same as the size of
+			 * @ref DarkHelp::NN::original_image, unless the image was decoded at a reduced resolution.
+			 *
+			 * @see @ref DarkHelp::Config::reduced_resolution_decode
+			 *
+			 * @since 2026-10-17
+			 */
+			cv::Size original_image_size;
+
 			/// The most recent output produced by @ref DarkHelp::NN::annotate().
 			cv::Mat annotated_image;
 
-			/// Intended mostly for internal purpose, this is only useful when annotation "snapping" is enabled.
+			/** Intended mostly for internal purpose, this is only useful when annotation "snapping" is enabled.  Only
+			 * the areas around the annotations are thresholded, the rest of the image is left blank.
+			 */
 			cv::Mat binary_inverted_image;
 
 			/** The number of horizontal tiles the image was split into by @ref DarkHelp::NN::predict_tile() prior to calling
@@ -489,15 +588,170 @@ namespace DarkHelp
 			/// Called from @ref DarkHelp::NN::predict_internal().  @see @ref DarkHelp::NN::predict()
 			void predict_internal_opencv();
 
+			/** Validate the network and normalize the threshold prior to making a prediction.  Called from both
+			 * @ref DarkHelp::NN::predict_internal() and @ref DarkHelp::NN::predict_batch().
+			 */
+			void prepare_to_predict(const float new_threshold);
+
+			/** Limit, name, sort and snap the predictions in @ref DarkHelp::NN::prediction_results.
+			 * @see @ref DarkHelp::Config::max_detections
+			 * @see @ref DarkHelp::Config::sort_predictions
+			 */
+			void post_process_predictions();
+
+			/** Keep only the @ref DarkHelp::Config::max_detections predictions with the highest probability.  This uses
+			 * a partial selection rather than a full sort, and the order of the predictions which remain is unspecified.
+			 */
+			NN & limit_predictions(PredictionResults & results);
+
+			/// Called from @ref DarkHelp::NN::predict_batch().  The number of images must not exceed @ref DarkHelp::Config::batch_size.
+			void predict_internal_darknet_batch(const std::vector<cv::Mat> & mats, std::vector<PredictionResults> & results);
+
+			/// Called from @ref DarkHelp::NN::predict_batch().  The number of images must not exceed @ref DarkHelp::Config::batch_size.
+			void predict_internal_opencv_batch(const std::vector<cv::Mat> & mats, std::vector<PredictionResults> & results);
+
+			/// Convert the Darknet @p detection array into %DarkHelp results.  The detections must be normalized (0...1).
+			void decode_darknet_detections(void * detections, const int number_of_detections, const cv::Size & image_size, PredictionResults & results);
+
+			/** Resize the image to match the network dimensions.  The resized image is stored in @ref DarkHelp::NN::buffers
+			 * so the same memory is used for every frame.  If the image is already the right size it is returned as-is.
+			 * @see @ref DarkHelp::Config::use_fast_image_resize
+			 */
+			cv::Mat resize_to_network(const cv::Mat & mat, const size_t index = 0);
+
 			/** Give a consistent name to the given production result.  This gets called by both @ref DarkHelp::NN::predict_internal()
-			 * and @ref DarkHelp::NN::predict_tile() and is intended for internal use only.
+			 * and @ref DarkHelp::NN::predict_tile() and is intended for internal use only.  This finds the best class and then
+			 * builds the name, unless @ref DarkHelp::Config::lazy_prediction_names has been enabled.
 			 */
 			NN & name_prediction(PredictionResult & pred);
 
+			/// Set @ref DarkHelp::PredictionResult::best_class and @ref DarkHelp::PredictionResult::best_probability.
+			NN & find_best_class(PredictionResult & pred);
+
+			/** Build @ref DarkHelp::NN::decode_thresholds from @ref DarkHelp::Config::threshold,
+			 * @ref DarkHelp::Config::class_thresholds and @ref DarkHelp::Config::ignored_classes.  Called by
+			 * @ref DarkHelp::NN::prepare_to_predict() prior to each prediction.
+			 */
+			NN & build_decode_thresholds();
+
+			/// The threshold a prediction of the given class must meet to be drawn by @ref DarkHelp::NN::annotate().
+			float annotation_threshold(const int class_idx) const;
+
+			/** The area of the image around @p rect which is thresholded and examined when snapping.  This is the entire
+			 * image unless @ref DarkHelp::Config::snapping_limit_region has been enabled.
+			 */
+			cv::Rect snapping_region(const cv::Rect & rect) const;
+
+			/** Threshold the area around @p rect into @ref DarkHelp::NN::binary_inverted_image.  When
+			 * @ref DarkHelp::Config::snapping_limit_region is enabled, only the areas around the annotations are
+			 * thresholded instead of the entire image.
+			 */
+			NN & prepare_snapping_region(const cv::Rect & rect);
+
+			/// Build @ref DarkHelp::NN::snapping_integral once all the regions have been prepared.
+			NN & build_snapping_integral();
+
+			/** Find the bounding rectangle of all non-zero pixels within @p roi using the integral image.  This is
+			 * equivalent to calling @p cv::findNonZero() and @p cv::boundingRect(), but requires no memory allocation.
+			 * The RoI must be within one of the regions previously passed to @ref DarkHelp::NN::prepare_snapping_region().
+			 */
+			cv::Rect find_snapping_rect(const cv::Rect & roi) const;
+
+			/** Snap an annotation once the region around it has been prepared and the integral image has been built.
+			 * This does not modify the %DarkHelp object, so multiple annotations can be snapped at the same time.
+			 * @see @ref DarkHelp::Config::snapping_in_parallel
+			 */
+			void snap_prepared_annotation(PredictionResult & pred) const;
+
+			/// Build the label text in @ref DarkHelp::PredictionResult::name.  The best class must already be known.
+			NN & build_prediction_name(PredictionResult & pred);
+
 			/// Size of the neural network, e.g., @p 416x416 or @p 608x608.  @see @ref DarkHelp::NN::network_size()
 			cv::Size network_dimensions;
 
 			/// The number of channels defined in the .cfg file.  This is normally set to @p 3.  @see @ref image_channels()
 			int number_of_channels;
+
+			/** Working buffers re-used from one frame to the next, such as the resized image, the Darknet input, and the
+			 * OpenCV blob.  These are allocated by @ref DarkHelp::NN::init() once the network dimensions are known.
+			 * @see @ref DarkHelp::NN::reallocation_count()
+			 */
+			BufferPool buffers;
+
+			/// Labels which have already been rendered by @ref DarkHelp::NN::annotate().  @see @ref DarkHelp::Config::annotation_label_cache_size
+			LabelCache labels;
+
+			/** The duration and timestamp rendered by @ref DarkHelp::NN::annotate().  The text changes much more often
+			 * than the prediction labels, so these are kept apart to prevent them from pushing the prediction labels out
+			 * of @ref DarkHelp::NN::labels.
+			 */
+			LabelCache overlay_labels;
+
+			/** @{ Re-used by @ref DarkHelp::NN::annotate() when shading predictions.  @p shade_rects has one rectangle per
+			 * prediction, and @p shade_regions are the groups of overlapping rectangles which are blended together.
+			 */
+			VRect shade_rects;
+			VRect shade_regions;
+			/// @}
+
+			/// The names of the YOLO output layers when using OpenCV's DNN module.  This is set once by @ref DarkHelp::NN::init().
+			VStr yolo_layer_names;
+
+			/// The output of the YOLO layers when using OpenCV's DNN module.  Kept between frames so the vectors can be re-used.
+			std::vector<std::vector<cv::Mat>> output_mats;
+
+			/** @{ The images and results passed to @ref DarkHelp::NN::predict_internal_darknet_batch() and
+			 * @ref DarkHelp::NN::predict_internal_opencv_batch().  These are kept between frames so the vectors don't have
+			 * to be allocated again for every image.  @p resized_images is used when several images are combined into a
+			 * single OpenCV blob.
+			 */
+			std::vector<cv::Mat>			batch_images;
+			std::vector<PredictionResults>	batch_results;
+			std::vector<cv::Mat>			resized_images;
+			/// @}
+
+			/** Candidate detections from the network output, before non-maximal suppression is applied.  The vectors
+			 * are cleared but not released between images, so once the first few frames have been processed there should
+			 * be no further memory allocations when decoding the YOLO output.
+			 */
+			struct Candidates
+			{
+				VRect2d	boxes;			///< Normalized coordinates of each candidate.
+				VFloat	scores;			///< Confidence of each candidate.
+				VInt	classes;		///< Class index of each candidate.
+				VInt	outputs;		///< Index into @ref output_mats of the YOLO layer which produced the candidate.  Only used with OpenCV.
+				VInt	rows;			///< Row within the YOLO layer output, or the index of the Darknet detection.
+				VInt	suppressed_by;	///< Set by @ref DarkHelp::non_maximal_suppression().  Only used with Darknet.
+
+				void clear()
+				{
+					boxes	.clear();
+					scores	.clear();
+					classes	.clear();
+					outputs	.clear();
+					rows	.clear();
+				}
+			};
+
+			/// Candidate detections re-used by @ref predict_internal_opencv_batch() and @ref decode_darknet_detections().
+			Candidates nms_candidates;
+
+			/** The threshold to use for each class while decoding the network output.  Classes listed in
+			 * @ref DarkHelp::Config::ignored_classes are set to infinity so they are never decoded.
+			 * @see @ref DarkHelp::NN::build_decode_thresholds()
+			 */
+			VFloat decode_thresholds;
+
+			/// The lowest value in @ref DarkHelp::NN::decode_thresholds.  Anything below this can be skipped immediately.
+			float lowest_decode_threshold;
+
+			/// The regions of @ref DarkHelp::NN::binary_inverted_image which have been thresholded.
+			VRect snapping_regions;
+
+			/// The bounding rectangle of all the @ref DarkHelp::NN::snapping_regions.
+			cv::Rect snapping_bounds;
+
+			/// Integral image of the non-zero pixels in @ref DarkHelp::NN::binary_inverted_image within @ref DarkHelp::NN::snapping_bounds.
+			cv::Mat snapping_integral;
 	};
 }
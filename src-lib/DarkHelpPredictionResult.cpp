@@ -6,9 +6,99 @@
 #include "DarkHelp.hpp"
 
 
+DarkHelp::ClassProbabilities::ClassProbabilities(const DarkHelp::MClassProbabilities & m) :
+	ClassProbabilities()
+{
+	// the map is already sorted, so every entry is appended to the end
+	for (const auto & iter : m)
+	{
+		operator[](iter.first) = iter.second;
+	}
+
+	return;
+}
+
+
+float & DarkHelp::ClassProbabilities::operator[](const int class_id)
+{
+	// predictions are built by looping through the classes in order, so the new entry normally goes at the end
+	value_type * first	= data();
+	value_type * last	= first + number_of_entries;
+	value_type * pos	= last;
+	if (number_of_entries > 0 and last[-1].first >= class_id)
+	{
+		pos = std::lower_bound(first, last, class_id,
+				[](const value_type & lhs, const int rhs)
+				{
+					return lhs.first < rhs;
+				});
+
+		if (pos->first == class_id)
+		{
+			return pos->second;
+		}
+	}
+
+	const size_t idx = pos - first;
+
+	if (not spilled and number_of_entries == inline_capacity)
+	{
+		// we've run out of room in the inline array, so move everything to the heap
+		heap.assign(entries.begin(), entries.end());
+		spilled = true;
+	}
+
+	if (spilled)
+	{
+		heap.insert(heap.begin() + idx, value_type(class_id, 0.0f));
+	}
+	else
+	{
+		std::move_backward(entries.begin() + idx, entries.begin() + number_of_entries, entries.begin() + number_of_entries + 1);
+		entries[idx] = value_type(class_id, 0.0f);
+	}
+
+	number_of_entries ++;
+
+	return data()[idx].second;
+}
+
+
+float DarkHelp::ClassProbabilities::at(const int class_id) const
+{
+	auto iter = find(class_id);
+	if (iter == end())
+	{
+		/// @throw std::out_of_range if the class does not exist.
+		throw std::out_of_range("class #" + std::to_string(class_id) + " does not exist");
+	}
+
+	return iter->second;
+}
+
+
+DarkHelp::ClassProbabilities::iterator DarkHelp::ClassProbabilities::find(const int class_id)
+{
+	auto last = end();
+	auto iter = std::lower_bound(begin(), last, class_id,
+			[](const value_type & lhs, const int rhs)
+			{
+				return lhs.first < rhs;
+			});
+
+	if (iter != last and iter->first == class_id)
+	{
+		return iter;
+	}
+
+	return last;
+}
+
+
 std::ostream & DarkHelp::operator<<(std::ostream & os, const DarkHelp::PredictionResult & pred)
 {
-	os	<< "\""			<< pred.name << "\""
+	// the name is empty when DarkHelp::Config::lazy_prediction_names is enabled, in which case show the class ID instead
+	os	<< "\""			<< (pred.name.empty() ? "#" + std::to_string(pred.best_class) : pred.name) << "\""
 		<< " #"			<< pred.best_class
 		<< " prob="		<< pred.best_probability
 		<< " x="		<< pred.rect.x
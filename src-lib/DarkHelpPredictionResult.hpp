@@ -10,6 +10,7 @@
 
 #include "DarkHelp.hpp"
 
+#include <array>
 #include <fstream>
 
 /** @file
@@ -26,6 +27,101 @@ namespace DarkHelp
 	 */
 	using MClassProbabilities = std::map<int, float>;
 
+	/** Compact container of class IDs and probabilities used by @ref DarkHelp::PredictionResult::all_probabilities.
+	 *
+	 * Most predictions only match 1 or 2 classes, so instead of allocating a @p std::map node for every class this stores
+	 * the pairs sorted by class ID in a small inline array, and only moves them to the heap when there are more than
+	 * @ref DarkHelp::ClassProbabilities::inline_capacity entries.  The API mimics the parts of @p std::map which are
+	 * commonly used, so code such as this continues to work as-is:
+	 *
+	 * ~~~~
+	 * for (const auto & [class_id, probability] : prediction.all_probabilities)
+	 * {
+	 *     std::cout << names[class_id] << " " << probability << std::endl;
+	 * }
+	 * ~~~~
+	 *
+	 * Call @ref DarkHelp::ClassProbabilities::to_map() if an actual @p std::map is needed.
+	 *
+	 * @note Unlike @p std::map the key in each pair is not @p const.  Do not modify the class IDs while iterating, since
+	 * the pairs must remain sorted.
+	 *
+	 * @since 2026-10-17
+	 */
+	class ClassProbabilities final
+	{
+		public:
+
+			/// Each entry is a class ID and the probability for that class.
+			using value_type		= std::pair<int, float>;
+			using iterator			= value_type *;
+			using const_iterator	= const value_type *;
+
+			/// The number of entries stored without allocating memory.
+			static constexpr size_t inline_capacity = 4;
+
+			/// Constructor.
+			ClassProbabilities() : number_of_entries(0), spilled(false) {}
+
+			/// Constructor.  Copy the entries from an existing map.
+			ClassProbabilities(const MClassProbabilities & m);
+
+			/// Destructor.
+			~ClassProbabilities() {}
+
+			/// Get the probability for the given class, inserting a probability of zero if the class does not yet exist.
+			float & operator[](const int class_id);
+
+			/// Get the probability for the given class.  @throw std::out_of_range if the class does not exist.
+			float at(const int class_id) const;
+
+			/// Returns @p 1 if the class exists, otherwise returns @p 0.
+			size_t count(const int class_id) const { return find(class_id) == end() ? 0 : 1; }
+
+			/// Find the given class, or return @ref end() if it does not exist.
+			iterator find(const int class_id);
+
+			/// Find the given class, or return @ref end() if it does not exist.
+			const_iterator find(const int class_id) const { return const_cast<ClassProbabilities*>(this)->find(class_id); }
+
+			/// The number of classes.
+			size_t size() const { return number_of_entries; }
+
+			/// Returns @p true if there are no classes.
+			bool empty() const { return number_of_entries == 0; }
+
+			/// Remove all of the entries.  Memory that has been allocated is kept so it can be re-used.
+			void clear() { number_of_entries = 0; spilled = false; heap.clear(); }
+
+			iterator		begin()			{ return data(); }
+			iterator		end()			{ return data() + number_of_entries; }
+			const_iterator	begin() const	{ return data(); }
+			const_iterator	end() const		{ return data() + number_of_entries; }
+
+			/// Copy all of the entries to a @p std::map.  Provided for compatibility with code that needs an actual map.
+			MClassProbabilities to_map() const { return MClassProbabilities(begin(), end()); }
+
+			/// Compare the class IDs and probabilities.
+			bool operator==(const ClassProbabilities & rhs) const { return std::equal(begin(), end(), rhs.begin(), rhs.end()); }
+
+			/// Compare the class IDs and probabilities.
+			bool operator!=(const ClassProbabilities & rhs) const { return not operator==(rhs); }
+
+		private:
+
+			value_type *		data()			{ return spilled ? heap.data() : entries.data(); }
+			const value_type *	data() const	{ return spilled ? heap.data() : entries.data(); }
+
+			/// The entries are stored here until there are more than @ref inline_capacity.
+			std::array<value_type, inline_capacity> entries;
+
+			/// Used instead of @ref entries once there are too many classes to store inline.
+			std::vector<value_type> heap;
+
+			size_t	number_of_entries;
+			bool	spilled;
+	};
+
 	/** Structure used to store interesting information on predictions.  A vector of these is created and returned
 	 * to the caller every time @ref DarkHelp::NN::predict() is called.  The most recent predictions are also stored
 	 * in @ref DarkHelp::NN::prediction_results.
@@ -120,7 +216,7 @@ namespace DarkHelp
 		 * @li 2 -> 0.958 // truck
 		 * @li 3 -> 0.603 // bus
 		 *
-		 * The C++ map would contains the following values:
+		 * The container would hold the following values (see @ref DarkHelp::ClassProbabilities):
 		 *
 		 * ~~~~
 		 * all_probabilities = { {0, 0.105}, {2, 0.958}, {3, 0.603} };
@@ -134,7 +230,7 @@ namespace DarkHelp
 		 * @li @ref DarkHelp::PredictionResult::best_class == 2
 		 * @li @ref DarkHelp::PredictionResult::best_probability == 0.958
 		 */
-		MClassProbabilities all_probabilities;
+		ClassProbabilities all_probabilities;
 
 		/** The class that obtained the highest probability.  For example, if an object is predicted to be 80% car
 		 * or 60% truck, then the class id of the car would be stored in this variable.
@@ -0,0 +1,182 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+
+/** @file
+ * Bounded multi-producer multi-consumer queue used by @ref DarkHelp::DHThreads.
+ */
+
+namespace DarkHelp
+{
+	/** Bounded lock-free queue which may be used by any number of threads at the same time, both to add and to remove
+	 * items.  This is Dmitry Vyukov's bounded MPMC queue:  each slot in the ring buffer has a sequence number which tells
+	 * both producers and consumers whether the slot is ready for them, so the only contention is a single
+	 * compare-and-swap on the head or the tail.
+	 *
+	 * The queue never blocks.  When the queue is full @ref try_push() returns @p false, and when the queue is empty
+	 * @ref try_pop() returns @p false.  Blocking and waking up threads is left to the caller, such as
+	 * @ref DarkHelp::DHThreads.
+	 *
+	 * @since 2026-10-17
+	 */
+	template <typename T>
+	class BoundedQueue final
+	{
+		public:
+
+			/// Constructor.  The capacity is rounded up to the next power of 2, with a minimum of 2.
+			explicit BoundedQueue(const size_t capacity);
+
+			/// Destructor.
+			~BoundedQueue() = default;
+
+			BoundedQueue(const BoundedQueue &) = delete;
+			BoundedQueue & operator=(const BoundedQueue &) = delete;
+
+			/// Add an item to the queue.  Returns @p false if the queue is full, in which case @p value is left untouched.
+			bool try_push(T && value);
+
+			/// Remove an item from the queue.  Returns @p false if the queue is empty.
+			bool try_pop(T & value);
+
+			/// The maximum number of items the queue can hold.
+			size_t capacity() const
+			{
+				return mask + 1;
+			}
+
+			/// The capacity a queue would have if constructed with the given capacity.
+			static size_t rounded_capacity(const size_t capacity)
+			{
+				size_t result = 2;
+				while (result < capacity)
+				{
+					result *= 2;
+				}
+
+				return result;
+			}
+
+		private:
+
+			/// Each slot in the queue.
+			struct Cell
+			{
+				std::atomic<size_t>	sequence;
+				T					data;
+			};
+
+			const size_t			mask;
+			std::unique_ptr<Cell[]>	cells;
+
+			/// @{ The head and the tail are kept on different cache lines so producers and consumers don't interfere.
+			alignas(64) std::atomic<size_t>	enqueue_pos;
+			alignas(64) std::atomic<size_t>	dequeue_pos;
+			/// @}
+	};
+}
+
+
+template <typename T>
+DarkHelp::BoundedQueue<T>::BoundedQueue(const size_t capacity) :
+	mask(rounded_capacity(capacity) - 1),
+	cells(new Cell[mask + 1]),
+	enqueue_pos(0),
+	dequeue_pos(0)
+{
+	for (size_t idx = 0; idx <= mask; idx ++)
+	{
+		cells[idx].sequence.store(idx, std::memory_order_relaxed);
+	}
+
+	return;
+}
+
+
+template <typename T>
+bool DarkHelp::BoundedQueue<T>::try_push(T && value)
+{
+	Cell * cell = nullptr;
+	size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		cell = &cells[pos & mask];
+		const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+		if (difference == 0)
+		{
+			// the slot is free, now try to claim it
+			if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// the queue is full
+			return false;
+		}
+		else
+		{
+			// another producer got here first
+			pos = enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->data = std::move(value);
+	cell->sequence.store(pos + 1, std::memory_order_release);
+
+	return true;
+}
+
+
+template <typename T>
+bool DarkHelp::BoundedQueue<T>::try_pop(T & value)
+{
+	Cell * cell = nullptr;
+	size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		cell = &cells[pos & mask];
+		const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+		if (difference == 0)
+		{
+			// the slot has an item, now try to claim it
+			if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// the queue is empty
+			return false;
+		}
+		else
+		{
+			// another consumer got here first
+			pos = dequeue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	value = std::move(cell->data);
+	cell->data = T(); // don't hold on to images once they've been handed out
+	cell->sequence.store(pos + mask + 1, std::memory_order_release);
+
+	return true;
+}
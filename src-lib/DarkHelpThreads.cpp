@@ -5,12 +5,74 @@
 
 #include "DarkHelpThreads.hpp"
 
+#include <fstream>
+#include <regex>
+
+
+/* Read the network dimensions from the .cfg file.  This is the same as what DarkHelp::NN::init() does, but is needed
+ * before the worker threads have loaded the neural network.  Returns 0x0 if the dimensions cannot be found.
+ */
+static inline cv::Size network_size_from_cfg(const std::string & filename)
+{
+	cv::Size size(0, 0);
+
+	const std::regex rx("^\\s*(width|height)\\s*=\\s*(\\d+)");
+	std::ifstream ifs(filename);
+	while (ifs.good() and (size.width <= 0 or size.height <= 0))
+	{
+		std::string line;
+		std::getline(ifs, line);
+		std::smatch sm;
+		if (std::regex_search(line, sm, rx))
+		{
+			const int value = std::stoi(sm.str(2));
+			if (sm.str(1) == "width")
+			{
+				size.width = value;
+			}
+			else
+			{
+				size.height = value;
+			}
+		}
+	}
+
+	return size;
+}
+
 
 DarkHelp::DHThreads::DHThreads() :
 	detele_input_file_after_processing(false),
 	annotate_output_images(false),
+	max_queued_images(64),
+	max_queued_files(4096),
+	max_frames_in_flight(32),
+	decode_threads(2),
+	output_threads(1),
+	max_decoded_images(0),
+	max_output_images(0),
+	stop_requested(true),
+	workers_running(0),
 	worker_threads_to_start(0),
+	workers_waiting(0),
+	producers_waiting(0),
+	results_waiting(0),
+	decoders_waiting(0),
+	writers_waiting(0),
+	input_files(new BoundedQueue<std::string>(max_queued_files)),
+	input_images(new BoundedQueue<QueuedImage>(max_queued_images)),
+	decoded_images(new BoundedQueue<QueuedImage>(2)),
+	output_files(new BoundedQueue<OutputFile>(2)),
+	files_queued(0),
+	images_queued(0),
+	decoded_queued(0),
+	output_queued(0),
+	decode_minimum_width(0),
+	decode_minimum_height(0),
 	input_image_index(0),
+	next_frame_sequence(0),
+	next_frame_to_deliver(0),
+	delivering_frames(false),
 	threads_ready(0),
 	files_processing(0)
 {
@@ -69,9 +131,13 @@ DarkHelp::DHThreads & DarkHelp::DHThreads::init(const DarkHelp::Config & c, cons
 	if (cfg.modify_batch_and_subdivisions)
 	{
 		DarkHelp::verify_cfg_and_weights(cfg.cfg_filename, cfg.weights_filename, cfg.names_filename);
+		if (cfg.batch_size < 1)
+		{
+			cfg.batch_size = 1;
+		}
 		const MStr m =
 		{
-			{"batch"		, "1"},
+			{"batch"		, std::to_string(cfg.batch_size)},
 			{"subdivisions"	, "1"}
 		};
 		edit_cfg_file(cfg.cfg_filename, m);
@@ -152,15 +218,58 @@ DarkHelp::DHThreads & DarkHelp::DHThreads::restart()
 {
 	stop();
 
+	/* The queues are empty and the worker threads have been stopped, so this is when the capacity can be changed.  But
+	 * add_image() may have been called on another thread, in which case it holds on to the queue, so the queues are only
+	 * replaced when the capacity actually changes and nobody is waiting for room in a queue.
+	 */
+	const auto resize = [this](auto & queue, const size_t capacity)
+	{
+		using Queue = typename std::remove_reference<decltype(*queue)>::type;
+		if (queue->capacity() != Queue::rounded_capacity(capacity) and producers_waiting == 0)
+		{
+			queue.reset(new Queue(capacity));
+		}
+	};
+	resize(input_files	, max_queued_files);
+	resize(input_images	, max_queued_images);
+
+	// only the stage threads use these queues, and each item is a full-size image, so by default keep them short
+	const size_t automatic_size = 2 * std::max(worker_threads_to_start, static_cast<size_t>(1));
+	decoded_images	.reset(new BoundedQueue<QueuedImage>(max_decoded_images	> 0 ? max_decoded_images	: automatic_size));
+	output_files	.reset(new BoundedQueue<OutputFile>	(max_output_images	> 0 ? max_output_images		: automatic_size));
+
+	// each stage needs at least 1 thread, otherwise the images would never make it through the pipeline
+	const size_t decoders	= std::max(decode_threads, static_cast<size_t>(1));
+	const size_t writers	= std::max(output_threads, static_cast<size_t>(1));
+
+	/* Images are decoded at a reduced resolution only when they remain larger than the network.  This is set before any
+	 * threads are started, otherwise the images read before the first network has loaded would be decoded at full size.
+	 */
+	if (cfg.reduced_resolution_decode and not cfg.enable_tiles)
+	{
+		const cv::Size network_size = network_size_from_cfg(cfg.cfg_filename);
+		decode_minimum_width	= network_size.width;
+		decode_minimum_height	= network_size.height;
+	}
+
 	input_image_index = 0;
+	workers_running = worker_threads_to_start;
 	stop_requested = false;
-	threads.reserve(worker_threads_to_start);
+	threads.reserve(worker_threads_to_start + decoders + writers);
 	networks.reserve(worker_threads_to_start);
 	for (size_t idx = 0; idx < worker_threads_to_start; idx ++)
 	{
 		networks.push_back(nullptr);
 		threads.emplace_back(std::thread(&DHThreads::run, this, idx));
 	}
+	for (size_t idx = 0; idx < decoders; idx ++)
+	{
+		threads.emplace_back(std::thread(&DHThreads::decode, this, idx));
+	}
+	for (size_t idx = 0; idx < writers; idx ++)
+	{
+		threads.emplace_back(std::thread(&DHThreads::write_output, this, idx));
+	}
 
 	return *this;
 }
@@ -170,25 +279,45 @@ DarkHelp::DHThreads & DarkHelp::DHThreads::stop()
 {
 	stop_requested = true;
 
-	for (auto & t : threads)
+	if (true)
 	{
-		trigger.notify_all();
+		// the lock guarantees that threads which have checked stop_requested are already waiting to be notified
+		std::scoped_lock lock(trigger_lock);
+		work_available	.notify_all();
+		room_available	.notify_all();
+		work_done		.notify_all();
+		files_available	.notify_all();
+		output_available.notify_all();
+	}
 
+	for (auto & t : threads)
+	{
 		if (t.joinable())
 		{
 			t.join();
 		}
 	}
 
+	discard_input();
+	reset_frames();
+
+	OutputFile output;
+	while (output_files->try_pop(output))
+	{
+		output_queued --;
+	}
+
 	threads				.clear();
 	networks			.clear();
-	input_files			.clear();
-	input_images		.clear();
 	all_results			.clear();
 	threads_ready		= 0;
 	files_processing	= 0;
 	input_image_index	= 0;
 
+	// restart() will set this again if cfg still allows images to be decoded at a reduced resolution
+	decode_minimum_width	= 0;
+	decode_minimum_height	= 0;
+
 	return *this;
 }
 
@@ -204,26 +333,140 @@ DarkHelp::DHThreads & DarkHelp::DHThreads::reset_image_index()
 
 std::string DarkHelp::DHThreads::add_image(cv::Mat image)
 {
-	if (image.empty())
+	QueuedImage queued_image{"", image, nullptr, nullptr};
+
+	return queue_image(queued_image);
+}
+
+
+bool DarkHelp::DHThreads::try_add_image(cv::Mat image, std::string & filename)
+{
+	QueuedImage queued_image{"", image, nullptr, nullptr};
+
+	return try_queue_image(queued_image, filename);
+}
+
+
+std::future<DarkHelp::PredictionResults> DarkHelp::DHThreads::submit(cv::Mat image)
+{
+	QueuedImage queued_image{"", image, std::make_shared<std::promise<DarkHelp::PredictionResults>>(), nullptr};
+	auto future = queued_image.promise->get_future();
+
+	queue_image(queued_image);
+
+	return future;
+}
+
+
+std::string DarkHelp::DHThreads::submit(cv::Mat image, Callback callback)
+{
+	QueuedImage queued_image{"", image, nullptr, callback};
+
+	return queue_image(queued_image);
+}
+
+
+size_t DarkHelp::DHThreads::add_frame(cv::Mat frame)
+{
+	if (not frame_callback)
 	{
-		throw std::invalid_argument("cannot add empty image");
+		/// @throw std::logic_error if the frame callback has not been set
+		throw std::logic_error("DHThreads frame callback must be set prior to calling add_frame()");
 	}
 
-	const std::string filename = "image_" + std::to_string(input_image_index++);
-//	std::cout << "adding OpenCV image as " << filename << std::endl;
+	size_t sequence = 0;
 
 	if (true)
 	{
-		std::scoped_lock lock(input_image_and_file_lock);
-		input_images[filename] = image;
+		// wait until the oldest frames have been delivered so the reorder buffer cannot grow without limit
+		std::unique_lock lock(frames_lock);
+		frames_delivered.wait(lock, [this]()
+			{
+				return workers_stopped() or next_frame_sequence - next_frame_to_deliver < std::max(max_frames_in_flight, static_cast<size_t>(1));
+			});
+
+		if (workers_stopped())
+		{
+			/// @throw std::logic_error if the worker threads are not running
+			throw std::logic_error("cannot add frame since the DHThreads worker threads are not running");
+		}
+
+		sequence = next_frame_sequence ++;
 	}
 
-	trigger.notify_all();
+	QueuedImage queued_image{"", frame, nullptr, [this, sequence, frame](const std::string &, const DarkHelp::PredictionResults & results, std::exception_ptr error)
+		{
+			// this is also called when the frame fails, otherwise the frames which follow would never be delivered
+			frame_done(sequence, frame, results, error);
+		}};
+
+	queue_image(queued_image);
+
+	return sequence;
+}
+
+
+DarkHelp::DHThreads & DarkHelp::DHThreads::wait_for_frames()
+{
+	std::unique_lock lock(frames_lock);
+	frames_delivered.wait(lock, [this]() { return workers_stopped() or next_frame_to_deliver == next_frame_sequence; });
+
+	return *this;
+}
+
+
+std::string DarkHelp::DHThreads::queue_image(QueuedImage & queued_image)
+{
+	std::string filename;
+
+	while (not try_queue_image(queued_image, filename))
+	{
+		if (workers_stopped())
+		{
+			/// @throw std::logic_error if the image queue is full and the worker threads are not running
+			throw std::logic_error("cannot add image since the DHThreads worker threads are not running");
+		}
+
+		wait_for_room(images_queued, input_images->capacity());
+	}
 
 	return filename;
 }
 
 
+bool DarkHelp::DHThreads::try_queue_image(QueuedImage & queued_image, std::string & filename)
+{
+	if (queued_image.image.empty())
+	{
+		throw std::invalid_argument("cannot add empty image");
+	}
+
+	// the count is incremented first so the worker threads can never see more images than what has been counted
+	if (++ images_queued > input_images->capacity())
+	{
+		images_queued --;
+		return false;
+	}
+
+	// only consume an index once we know there is room in the queue
+	queued_image.filename = "image_" + std::to_string(input_image_index++);
+	const std::string name = queued_image.filename;
+//	std::cout << "adding OpenCV image as " << name << std::endl;
+
+	if (not input_images->try_push(std::move(queued_image)))
+	{
+		// another thread has beat us to the last free slot
+		images_queued --;
+		return false;
+	}
+
+	filename = name;
+	wake(work_available, workers_waiting, false);
+
+	return true;
+}
+
+
 DarkHelp::DHThreads & DarkHelp::DHThreads::add_images(const std::filesystem::path & dir)
 {
 	if (worker_threads_to_start < 1)
@@ -236,12 +479,8 @@ DarkHelp::DHThreads & DarkHelp::DHThreads::add_images(const std::filesystem::pat
 
 	if (std::filesystem::is_regular_file(path))
 	{
-		if (true)
-		{
-			std::scoped_lock lock(input_image_and_file_lock);
-			input_files.push_back(path.string());
-		}
-		trigger.notify_all();
+		std::string filename = path.string();
+		queue(*input_files, files_queued, filename, files_available, decoders_waiting);
 	}
 	else if (std::filesystem::is_directory(path))
 	{
@@ -265,12 +504,11 @@ DarkHelp::DHThreads & DarkHelp::DHThreads::add_images(const std::filesystem::pat
 				ext == ".png"	or
 				ext == ".PNG"	)
 			{
-				if (true)
+				std::string filename = entry.path().string();
+				if (not queue(*input_files, files_queued, filename, files_available, decoders_waiting))
 				{
-					std::scoped_lock lock(input_image_and_file_lock);
-					input_files.push_back(entry.path().string());
+					break;
 				}
-				trigger.notify_all();
 			}
 		}
 	}
@@ -286,17 +524,11 @@ DarkHelp::DHThreads & DarkHelp::DHThreads::purge()
 		throw std::logic_error("DHThreads worker threads and neural networks have not yet been initialized");
 	}
 
-	if (not input_images.empty() or not input_files.empty())
-	{
-		std::scoped_lock lock(input_image_and_file_lock);
-
-		input_images.clear();
-		input_image_index = 0;
-
-		input_files.clear();
-	}
+	discard_input();
+	input_image_index = 0;
 
 	wait_for_results();
+	reset_frames();
 
 	return *this;
 }
@@ -309,15 +541,12 @@ DarkHelp::DHThreads::ResultsMap DarkHelp::DHThreads::wait_for_results()
 		throw std::logic_error("DHThreads worker threads and neural networks have not yet been initialized");
 	}
 
-	while (not stop_requested)
+	if (true)
 	{
-		if (files_remaining() == 0)
-		{
-			break;
-		}
-
 		std::unique_lock lock(trigger_lock);
-		trigger.wait_for(lock, std::chrono::seconds(2));
+		results_waiting ++;
+		work_done.wait(lock, [this]() { return workers_stopped() or files_remaining() == 0; });
+		results_waiting --;
 	}
 
 	return get_results();
@@ -357,97 +586,455 @@ void DarkHelp::DHThreads::run(const size_t id)
 
 		while (not stop_requested)
 		{
-			if (input_files.empty() and input_images.empty())
+			QueuedImage input;
+
+			if (not next_input(input))
 			{
 				std::unique_lock lock(trigger_lock);
-				trigger.wait_for(lock, std::chrono::seconds(2));
+				workers_waiting ++;
+				work_available.wait(lock, [this]() { return stop_requested or images_queued + decoded_queued > 0; });
+				workers_waiting --;
+				continue;
 			}
 
-			if (input_files.size() == 0 and input_images.size() == 0)
+			bool handed_off = false;
+			try
 			{
-				continue;
+				handed_off = process(nn, input);
 			}
-
-			cv::Mat mat;
-			std::string fn;
-
-			if (not stop_requested and not input_images.empty())
+			catch (...)
 			{
-				// get an OpenCV image
-
-				std::scoped_lock lock(input_image_and_file_lock);
-				if (input_images.empty() == false)
+				// if the caller is waiting on a future or a callback, give them the exception and keep this thread running
+				if (input.promise)
+				{
+					input.promise->set_exception(std::current_exception());
+				}
+				else if (input.callback)
+				{
+					call_callback(input, DarkHelp::PredictionResults(), std::current_exception());
+				}
+				else
 				{
-					fn = input_images.begin()->first;
-					mat = input_images[fn];
-					input_images.erase(fn);
-					files_processing ++;
+					// nobody is waiting on this image, so log the problem and store an empty result
+					try
+					{
+						throw;
+					}
+					catch (const std::exception & e)
+					{
+						std::cout << id << ": failed to process " << input.filename << ": " << e.what() << std::endl;
+					}
+					catch (...)
+					{
+						std::cout << id << ": failed to process " << input.filename << std::endl;
+					}
+
+					std::scoped_lock lock(results_lock);
+					all_results[input.filename] = DarkHelp::PredictionResults();
 				}
 			}
-			else if (not stop_requested and not input_files.empty())
+
+			if (not handed_off)
 			{
-				// get an image filename
+				finished_processing();
+			}
+		}
+	}
+	catch (const std::exception & e)
+	{
+		std::cout << id << ": caught exception: " << e.what() << std::endl;
+	}
+
+//	std::cout << id << ": ending thread" << std::endl;
+	networks[id] = nullptr;
+	threads_ready --;
+
+	if (-- workers_running == 0)
+	{
+		// nothing will ever be removed from the queues, so wake up anyone waiting for room or waiting for results
+		if (true)
+		{
+			std::scoped_lock lock(trigger_lock);
+			room_available	.notify_all();
+			work_done		.notify_all();
+		}
+		std::scoped_lock lock(frames_lock);
+		frames_delivered.notify_all();
+	}
+
+	return;
+}
+
+
+bool DarkHelp::DHThreads::process(DarkHelp::NN & nn, QueuedImage & input)
+{
+	const std::string & fn = input.filename;
 
-				std::scoped_lock lock(input_image_and_file_lock);
-				if (input_files.empty() == false)
+	if (not input.decode_error.empty())
+	{
+		// the decode thread failed to read this file, so there is nothing for the neural network to do
+		std::cout << "failed to read " << fn << ": " << input.decode_error << std::endl;
+
+		std::scoped_lock lock(results_lock);
+		all_results[fn] = DarkHelp::PredictionResults();
+
+		return false;
+	}
+
+	DarkHelp::PredictionResults results = nn.predict_reduced(input.image, input.original_size);
+
+	// the annotations need this neural network, but encoding and writing the image is left to the output threads
+	OutputFile output;
+	if (annotate_output_images)
+	{
+		// if the image was decoded at a reduced resolution, the annotated image is still written at the original size
+		output.annotated_filename = output_dir / (std::filesystem::path(fn).stem().string() + ".jpg");
+		nn.annotate(output.annotated_image, input.original_size);
+	}
+
+	if (input.decoded_from_file and detele_input_file_after_processing)
+	{
+		output.input_filename = fn;
+	}
+
+	// images from submit() go directly back to the caller instead of into all_results
+	if (input.promise)
+	{
+		input.promise->set_value(std::move(results));
+	}
+	else if (input.callback)
+	{
+		call_callback(input, results, nullptr);
+	}
+	else
+	{
+		std::scoped_lock lock(results_lock);
+		all_results[fn] = results;
+	}
+
+	if (output.annotated_image.empty() and output.input_filename.empty())
+	{
+		return false;
+	}
+
+	return queue(*output_files, output_queued, output, output_available, writers_waiting);
+}
+
+
+void DarkHelp::DHThreads::decode(const size_t id)
+{
+	try
+	{
+		while (not stop_requested)
+		{
+			QueuedImage input;
+
+			if (not input_files->try_pop(input.filename))
+			{
+				std::unique_lock lock(trigger_lock);
+				decoders_waiting ++;
+				files_available.wait(lock, [this]() { return stop_requested or files_queued > 0; });
+				decoders_waiting --;
+				continue;
+			}
+
+			// see next_input() for why files_processing is incremented first
+			files_processing ++;
+			files_queued --;
+			wake(room_available, producers_waiting, true);
+
+			try
+			{
+				// when reduced resolution decoding is disabled the minimum size is zero and the image is decoded at full size
+				const cv::Size minimum_size(decode_minimum_width, decode_minimum_height);
+				input.image = DarkHelp::read_image(input.filename, minimum_size, input.original_size);
+				if (input.image.empty())
 				{
-					fn = input_files.front();
-					input_files.pop_front();
-					files_processing ++;
+					input.decode_error = "image is empty";
 				}
 			}
+			catch (const std::exception & e)
+			{
+				// leave the image empty so the neural network worker thread records the problem without reading the file again
+				input.image			= cv::Mat();
+				input.decode_error	= e.what();
+			}
+			catch (...)
+			{
+				input.image			= cv::Mat();
+				input.decode_error	= "unknown error";
+			}
+			input.decoded_from_file = true;
 
-			if (not input_images.empty() or not input_files.empty())
+			if (not queue(*decoded_images, decoded_queued, input, work_available, workers_waiting))
 			{
-				// let another thread know there are still some input files that remain
-				trigger.notify_all();
+				finished_processing();
 			}
+		}
+	}
+	catch (const std::exception & e)
+	{
+		std::cout << "decode " << id << ": caught exception: " << e.what() << std::endl;
+	}
 
-			if (not fn.empty())
+	return;
+}
+
+
+void DarkHelp::DHThreads::write_output(const size_t id)
+{
+	try
+	{
+		while (not stop_requested)
+		{
+			OutputFile output;
+
+			if (not output_files->try_pop(output))
 			{
-				DarkHelp::PredictionResults results;
+				std::unique_lock lock(trigger_lock);
+				writers_waiting ++;
+				output_available.wait(lock, [this]() { return stop_requested or output_queued > 0; });
+				writers_waiting --;
+				continue;
+			}
 
-				if (mat.empty())
-				{
-					results = nn.predict(fn);
-				}
-				else
-				{
-					results = nn.predict(mat);
-				}
+			output_queued --;
+			wake(room_available, producers_waiting, true);
 
-				if (annotate_output_images)
+			try
+			{
+				if (not output.annotated_image.empty())
 				{
-					const auto annotated_image_fn = output_dir / (std::filesystem::path(fn).stem().string() + ".jpg");
-					cv::imwrite(annotated_image_fn.string(), nn.annotate(), {cv::IMWRITE_JPEG_QUALITY, 75});
+					cv::imwrite(output.annotated_filename.string(), output.annotated_image, {cv::IMWRITE_JPEG_QUALITY, 75});
 				}
 
-				if (mat.empty() and detele_input_file_after_processing)
+				if (not output.input_filename.empty())
 				{
-					std::filesystem::remove(fn);
+					std::filesystem::remove(output.input_filename);
 				}
+			}
+			catch (const std::exception & e)
+			{
+				// keep this thread running, otherwise the worker threads would eventually block waiting for room in the queue
+				std::cout << "output " << id << ": failed to write " << output.annotated_filename.string() << ": " << e.what() << std::endl;
+			}
+			catch (...)
+			{
+				std::cout << "output " << id << ": failed to write " << output.annotated_filename.string() << std::endl;
+			}
 
-				if (true)
-				{
-					std::scoped_lock lock(results_lock);
-					all_results[fn] = results;
-				}
+			finished_processing();
+		}
+	}
+	catch (const std::exception & e)
+	{
+		std::cout << "output " << id << ": caught exception: " << e.what() << std::endl;
+	}
 
-				files_processing --;
+	return;
+}
 
-				// in case wait_for_results() has been called, we want to notify so it can return once all images are done
-				trigger.notify_all();
-			}
-		}
+
+void DarkHelp::DHThreads::call_callback(QueuedImage & input, const DarkHelp::PredictionResults & results, std::exception_ptr error)
+{
+	try
+	{
+		input.callback(input.filename, results, error);
 	}
 	catch (const std::exception & e)
 	{
-		std::cout << id << ": caught exception: " << e.what() << std::endl;
+		std::cout << input.filename << ": callback threw an exception: " << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cout << input.filename << ": callback threw an unknown exception" << std::endl;
 	}
 
-//	std::cout << id << ": ending thread" << std::endl;
-	networks[id] = nullptr;
-	threads_ready --;
+	return;
+}
+
+
+void DarkHelp::DHThreads::finished_processing()
+{
+	files_processing --;
+
+	// in case wait_for_results() has been called, we want to notify so it can return once all images are done
+	if (files_remaining() == 0)
+	{
+		wake(work_done, results_waiting, true);
+	}
+
+	return;
+}
+
+
+bool DarkHelp::DHThreads::next_input(QueuedImage & input)
+{
+	// files_processing is incremented before the queued count is decremented so files_remaining() never drops to zero early
+
+	if (input_images->try_pop(input))
+	{
+		files_processing ++;
+		images_queued --;
+		wake(room_available, producers_waiting, true);
+
+		return true;
+	}
+
+	// images from the decode threads are already counted in files_processing
+	if (decoded_images->try_pop(input))
+	{
+		decoded_queued --;
+		wake(room_available, producers_waiting, true);
+
+		return true;
+	}
+
+	return false;
+}
+
+
+template <typename T>
+bool DarkHelp::DHThreads::queue(BoundedQueue<T> & destination, std::atomic<size_t> & queued, T & item, std::condition_variable & cv, std::atomic<size_t> & waiting)
+{
+	while (not workers_stopped())
+	{
+		if (++ queued <= destination.capacity() and destination.try_push(std::move(item)))
+		{
+			wake(cv, waiting, false);
+
+			return true;
+		}
+
+		queued --;
+		wait_for_room(queued, destination.capacity());
+	}
+
+	return false;
+}
+
+
+void DarkHelp::DHThreads::wait_for_room(const std::atomic<size_t> & queued, const size_t capacity)
+{
+	std::unique_lock lock(trigger_lock);
+	producers_waiting ++;
+	room_available.wait(lock, [&]() { return workers_stopped() or queued < capacity; });
+	producers_waiting --;
+
+	return;
+}
+
+
+void DarkHelp::DHThreads::discard_input()
+{
+	QueuedImage queued_image;
+	while (input_images->try_pop(queued_image))
+	{
+		images_queued --;
+	}
+
+	std::string filename;
+	while (input_files->try_pop(filename))
+	{
+		files_queued --;
+	}
+
+	// decoded images have already been removed from the input queue, so they're also counted as being processed
+	while (decoded_images->try_pop(queued_image))
+	{
+		decoded_queued --;
+		finished_processing();
+	}
+
+	wake(room_available, producers_waiting, true);
+
+	return;
+}
+
+
+void DarkHelp::DHThreads::wake(std::condition_variable & cv, const std::atomic<size_t> & waiting, const bool everyone)
+{
+	// the sleeping threads increment their count while holding the lock and before checking their condition, so if the
+	// count is zero then nobody can be about to go to sleep without first seeing the change made by the caller
+	if (waiting > 0)
+	{
+		std::scoped_lock lock(trigger_lock);
+		if (everyone)
+		{
+			cv.notify_all();
+		}
+		else
+		{
+			cv.notify_one();
+		}
+	}
+
+	return;
+}
+
+
+void DarkHelp::DHThreads::frame_done(const size_t sequence, cv::Mat frame, const DarkHelp::PredictionResults & results, std::exception_ptr error)
+{
+	std::unique_lock lock(frames_lock);
+	reordered_frames[sequence] = {frame, results, error};
+
+	if (delivering_frames)
+	{
+		// another worker thread is already delivering results and will pick up this frame when it gets to it
+		return;
+	}
+
+	delivering_frames = true;
+
+	while (true)
+	{
+		auto iter = reordered_frames.begin();
+		if (iter == reordered_frames.end() or iter->first != next_frame_to_deliver)
+		{
+			// still waiting for an earlier frame
+			break;
+		}
+
+		const size_t sequence_to_deliver = iter->first;
+		auto item = std::move(iter->second);
+		reordered_frames.erase(iter);
+
+		// the lock is released while the callback runs so the other worker threads can continue to store their results
+		lock.unlock();
+		try
+		{
+			frame_callback(sequence_to_deliver, item.frame, item.results, item.error);
+		}
+		catch (const std::exception & e)
+		{
+			// keep going, otherwise the frames which are already waiting would not be delivered
+			std::cout << "frame " << sequence_to_deliver << ": callback threw an exception: " << e.what() << std::endl;
+		}
+		catch (...)
+		{
+			std::cout << "frame " << sequence_to_deliver << ": callback threw an unknown exception" << std::endl;
+		}
+		lock.lock();
+
+		next_frame_to_deliver ++;
+		frames_delivered.notify_all();
+	}
+
+	delivering_frames = false;
+
+	return;
+}
+
+
+void DarkHelp::DHThreads::reset_frames()
+{
+	std::scoped_lock lock(frames_lock);
+
+	reordered_frames.clear();
+	next_frame_sequence		= 0;
+	next_frame_to_deliver	= 0;
+	delivering_frames		= false;
+	frames_delivered.notify_all();
 
 	return;
 }
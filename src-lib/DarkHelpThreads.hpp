@@ -4,10 +4,14 @@
  */
 
 #include "DarkHelp.hpp"
+#include "DarkHelpQueue.hpp"
 
 #include <atomic>
 #include <condition_variable>
+#include <exception>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <mutex>
 #include <thread>
 
@@ -34,6 +38,11 @@ namespace DarkHelp
 	 * (Each instance of the network consumes 289 MiB of vram, which is why 13 copies can be loaded at once on a GPU with
 	 * 4 GiB of vram.)
 	 *
+	 * Images are processed in stages, each with its own pool of threads:  image files are read and decoded by the
+	 * @ref decode_threads, predictions are made by the worker threads which have loaded the neural network, and the
+	 * annotated images are encoded and written to disk by the @ref output_threads.  The stages are connected by bounded
+	 * queues, so the threads running the neural networks don't have to wait on the disk or the image codecs.
+	 *
 	 * Note this header file is not included by @p DarkHelp.hpp.  To use this functionality you'll need to explicitely
 	 * include this header file.
 	 *
@@ -52,6 +61,24 @@ namespace DarkHelp
 			 */
 			using ResultsMap = std::map<std::string, DarkHelp::PredictionResults>;
 
+			/** Callback used by @ref submit().  The first parameter is the "virtual" filename which was returned by
+			 * @ref submit(), and the second parameter contains the prediction results for that image.  If the image could
+			 * not be processed, the results are empty and the last parameter contains the exception, otherwise it is
+			 * @p nullptr.
+			 *
+			 * @since 2026-10-17
+			 */
+			using Callback = std::function<void(const std::string & filename, const DarkHelp::PredictionResults & results, std::exception_ptr error)>;
+
+			/** Callback used by @ref add_frame().  The first parameter is the sequence number returned by @ref add_frame(),
+			 * the second is the frame itself, and the third contains the prediction results for that frame.  If the frame
+			 * could not be processed, the results are empty and the last parameter contains the exception, otherwise it is
+			 * @p nullptr.
+			 *
+			 * @since 2026-10-17
+			 */
+			using FrameCallback = std::function<void(const size_t sequence, cv::Mat frame, const DarkHelp::PredictionResults & results, std::exception_ptr error)>;
+
 			/** Constructor.  No worker threads are started with this constructor.  You'll need to manually call @ref init().
 			 *
 			 * @since 2024-03-26
@@ -148,6 +175,12 @@ namespace DarkHelp
 			 * @note Images added via @ref add_image() will be processed before filenames added via @ref add_images().  This
 			 * is done to ensure that memory is freed up as quickly as possible (filenames barely take any memory).
 			 *
+			 * @note If @ref max_queued_images are already waiting to be processed, then this will block until one of the
+			 * worker threads picks up an image.  Use @ref try_add_image() if you'd rather not wait.
+			 *
+			 * @throw std::logic_error if the queue is full and the worker threads are not running, or if all the worker
+			 * threads have exited (for example because the neural network could not be loaded).
+			 *
 			 * @see @ref add_images()
 			 * @see @ref reset_image_index()
 			 *
@@ -155,6 +188,76 @@ namespace DarkHelp
 			 */
 			std::string add_image(cv::Mat image);
 
+			/** Similar to @ref add_image(), but never blocks.  If @ref max_queued_images are already waiting to be processed,
+			 * then the image is not added and @p false is returned.
+			 *
+			 * @param [in] image The OpenCV image to process.
+			 * @param [out] filename The "virtual" filename which represents the image.  This is only set when the image
+			 * has been added.
+			 *
+			 * @since 2026-10-17
+			 */
+			bool try_add_image(cv::Mat image, std::string & filename);
+
+			/** Add a single image to be processed, and get back a future for the results of that image.  Unlike
+			 * @ref add_image(), the results are not stored with the rest of the results returned by @ref get_results() and
+			 * @ref wait_for_results(), so multiple callers can each submit images and wait for their own results without
+			 * having to coordinate with each other.
+			 *
+			 * If the neural network throws an exception while processing the image, the exception is stored in the future.
+			 * If the image is discarded by @ref purge() or @ref stop() before it has been processed, the future will throw
+			 * @p std::future_error with @p std::future_errc::broken_promise.
+			 *
+			 * Like @ref add_image(), this will block if @ref max_queued_images are already waiting to be processed.
+			 *
+			 * @since 2026-10-17
+			 */
+			std::future<DarkHelp::PredictionResults> submit(cv::Mat image);
+
+			/** Similar to the other @ref submit(), but the given callback is called once the image has been processed.
+			 *
+			 * The callback is called exactly once for each image, even if the neural network throws an exception while
+			 * processing the image, in which case the exception is passed to the callback.  If the callback itself throws,
+			 * the exception is logged to @p std::cout and ignored, and the worker thread keeps running.
+			 *
+			 * @note The callback is called on the worker thread which processed the image, so it should return quickly.  If
+			 * the image is discarded by @ref purge() or @ref stop() before it has been processed, the callback is never
+			 * called.
+			 *
+			 * @return The "virtual" filename which will be passed to the callback.
+			 *
+			 * @since 2026-10-17
+			 */
+			std::string submit(cv::Mat image, Callback callback);
+
+			/** Add a video frame to be processed.  Frames are processed in parallel by all the worker threads, but the results
+			 * are always delivered to @ref frame_callback in the same order the frames were added, as soon as all of the
+			 * previous frames have been delivered.  This allows a single video stream to be processed by many copies of the
+			 * neural network without losing the frame order.
+			 *
+			 * This will block if @ref max_frames_in_flight frames have been added but not yet delivered, so the amount of
+			 * memory used does not depend on the length of the video.
+			 *
+			 * Every frame is delivered, even if processing it failed, in which case the exception is passed to
+			 * @ref frame_callback.  If @ref frame_callback throws, the exception is logged to @p std::cout and ignored.
+			 *
+			 * @return The sequence number of the frame, starting at zero.  This is reset by @ref purge() and @ref restart().
+			 *
+			 * @throw std::logic_error if @ref frame_callback has not been set, or if the worker threads are not running.
+			 *
+			 * @see @ref wait_for_frames()
+			 *
+			 * @since 2026-10-17
+			 */
+			size_t add_frame(cv::Mat frame);
+
+			/** Returns when the results for all of the frames added via @ref add_frame() have been delivered to
+			 * @ref frame_callback.
+			 *
+			 * @since 2026-10-17
+			 */
+			DHThreads & wait_for_frames();
+
 			/** Can be used to add a single image, or a subdirectory.  If a subdirectory, then recurse looking for all images.
 			 * Call this as many times as necessary until all images have been added.  Image processing by the worker threads
 			 * will start immediately.  Additional images can be added at any time, even while the worker threads have already
@@ -163,6 +266,9 @@ namespace DarkHelp
 			 * @note Images added via @ref add_image() will be processed before filenames added via @ref add_images().  This
 			 * is done to ensure that memory is freed up as quickly as possible.
 			 *
+			 * @note If @ref max_queued_files are already waiting to be processed, then this will block until the worker threads
+			 * have caught up.
+			 *
 			 * @see @ref add_image()
 			 *
 			 * @since 2024-03-26
@@ -170,7 +276,8 @@ namespace DarkHelp
 			DHThreads & add_images(const std::filesystem::path & dir);
 
 			/** Removes all input files, waits for all worker threads to finish processing, clears out any results, and resets
-			 * the image index (similar to @ref reset_image_index()).
+			 * the image index (similar to @ref reset_image_index()).  Frames added via @ref add_frame() which have not yet
+			 * been delivered are discarded, and the frame sequence number is reset.
 			 *
 			 * Unlike the call to @ref stop(), calling @ref purge() does not terminate the worker threads or unload the neural
 			 * networks, so you can immediately call @ref add_image() or @ref add_images() without needing to @ref restart().
@@ -186,7 +293,7 @@ namespace DarkHelp
 			 */
 			size_t files_remaining() const
 			{
-				return input_images.size() + input_files.size() + files_processing;
+				return images_queued + files_queued + files_processing;
 			}
 
 			/** Get the number of worker threads which have loaded a copy of the neural network.
@@ -199,8 +306,11 @@ namespace DarkHelp
 			}
 
 			/** Returns when there are zero input files remaining and all worker threads have finished processing images.
+			 * Also returns if all the worker threads have exited, in which case some images will not have been processed.
 			 * Note this will clear out the results since it internally calls @ref get_results().
 			 *
+			 * Files which cannot be read or processed are logged, and are included in the results with no predictions.
+			 *
 			 * The difference between @ref wait_for_results() and @ref get_results() is that @p wait_for_results() will
 			 * wait until @em all the results are available, while @p get_results() will immediately return with whatever
 			 * results are available at this point in time.
@@ -250,14 +360,175 @@ namespace DarkHelp
 			 */
 			std::atomic<bool> annotate_output_images;
 
+			/** The maximum number of images added via @ref add_image() which can be waiting for a worker thread.  This limits
+			 * the amount of memory used when images are added faster than they can be processed.  Default value is @p 64.
+			 * This is only referenced by @ref restart(), and is ignored if another thread is blocked in @ref add_image() at
+			 * that time.
+			 *
+			 * @since 2026-10-17
+			 */
+			size_t max_queued_images;
+
+			/** The maximum number of filenames added via @ref add_images() which can be waiting for a worker thread.  Default
+			 * value is @p 4096.  This is only referenced by @ref restart().
+			 *
+			 * @since 2026-10-17
+			 */
+			size_t max_queued_files;
+
+			/** Callback used to deliver the results of frames added via @ref add_frame().  This must be set prior to calling
+			 * @ref add_frame().  Results are delivered in frame order, one at a time, from whichever worker thread completed
+			 * the prefix of frames.
+			 *
+			 * @since 2026-10-17
+			 */
+			FrameCallback frame_callback;
+
+			/** The maximum number of frames which can have been added via @ref add_frame() without yet having been delivered to
+			 * @ref frame_callback.  Default value is @p 32.
+			 *
+			 * @since 2026-10-17
+			 */
+			size_t max_frames_in_flight;
+
+			/** The number of threads used to read and decode the image files added via @ref add_images().  These threads run
+			 * independently of the worker threads which have loaded the neural network.  Default value is @p 2.  This is only
+			 * referenced by @ref restart().
+			 *
+			 * @since 2026-10-17
+			 */
+			size_t decode_threads;
+
+			/** The number of threads used to encode and write the annotated images when @ref annotate_output_images is
+			 * enabled, and to delete the input files when @ref detele_input_file_after_processing is enabled.  Default value
+			 * is @p 1.  This is only referenced by @ref restart().
+			 *
+			 * @since 2026-10-17
+			 */
+			size_t output_threads;
+
+			/** The maximum number of images decoded by the @ref decode_threads which can be waiting for the neural network.
+			 * Each of these is a full decoded image, so this should be kept small.  Default value is @p 0, which means twice
+			 * the number of worker threads.  Like the other queues, the size is rounded up to the next power of 2.  This is
+			 * only referenced by @ref restart().
+			 *
+			 * @since 2026-10-18
+			 */
+			size_t max_decoded_images;
+
+			/** The maximum number of annotated images which can be waiting for the @ref output_threads.  Default value is
+			 * @p 0, which means twice the number of worker threads.  This is only referenced by @ref restart().
+			 *
+			 * @since 2026-10-18
+			 */
+			size_t max_output_images;
+
 		private:
 
-			/// The method that each worker thread runs to process images.  @see @ref restart()
+			/** An image added via @ref add_image() or @ref submit() and the "virtual" filename used to represent it.  This is
+			 * also used for filenames added via @ref add_images(), in which case the image is empty.
+			 */
+			struct QueuedImage
+			{
+				std::string	filename;
+				cv::Mat		image;
+
+				/// Only used by @ref submit() when the caller is waiting on a future.
+				std::shared_ptr<std::promise<DarkHelp::PredictionResults>> promise;
+
+				/// Only used by @ref submit() when the caller has provided a callback.
+				Callback callback;
+
+				/// Set by @ref decode() when the image was read from @p filename.
+				bool decoded_from_file = false;
+
+				/// Set by @ref decode() to the full size of the image, which may be larger than @p image.
+				cv::Size original_size = cv::Size(0, 0);
+
+				/// Set by @ref decode() when the file could not be read, in which case @p image is empty.
+				std::string decode_error = "";
+			};
+
+			/// Work which is handed from the neural network worker threads to the @ref output_threads.
+			struct OutputFile
+			{
+				std::filesystem::path	annotated_filename;	///< Where to write @p annotated_image.
+				cv::Mat					annotated_image;	///< Empty if there is nothing to write.
+				std::filesystem::path	input_filename;		///< Empty if the input file is not deleted.
+			};
+
+			/// Add an image to the queue without blocking.  The filename is generated once there is room in the queue.
+			bool try_queue_image(QueuedImage & queued_image, std::string & filename);
+
+			/// Add an image to the queue, waiting for room if the queue is full.  Returns the filename.
+			std::string queue_image(QueuedImage & queued_image);
+
+			/// Get the next image or filename to process.  Images are always returned before filenames.
+			bool next_input(QueuedImage & input);
+
+			/** Process a single image.  This is called by @ref run().  Returns @p true if the image has been handed to the
+			 * @ref output_threads, in which case they're responsible for decrementing @ref files_processing.
+			 */
+			bool process(DarkHelp::NN & nn, QueuedImage & input);
+
+			/// The method that each of the @ref decode_threads runs to read image files.  @see @ref restart()
+			void decode(const size_t id);
+
+			/// The method that each of the @ref output_threads runs to write annotated images.  @see @ref restart()
+			void write_output(const size_t id);
+
+			/// Call the callback from @ref submit().  Exceptions thrown by the callback are logged and ignored.
+			void call_callback(QueuedImage & input, const DarkHelp::PredictionResults & results, std::exception_ptr error);
+
+			/// Decrement @ref files_processing, and wake up @ref wait_for_results() if all images are done.
+			void finished_processing();
+
+			/** Add an item to one of the queues, waiting for room if the queue is full.  Returns @p false if the threads are
+			 * stopped before there is room in the queue.
+			 */
+			template <typename T>
+			bool queue(BoundedQueue<T> & destination, std::atomic<size_t> & queued, T & item, std::condition_variable & cv, std::atomic<size_t> & waiting);
+
+			/// Wait until the image queue or file queue has room for another item.
+			void wait_for_room(const std::atomic<size_t> & queued, const size_t capacity);
+
+			/// A frame from @ref add_frame() which has been processed but not yet delivered to @ref frame_callback.
+			struct ReorderedFrame
+			{
+				cv::Mat						frame;
+				DarkHelp::PredictionResults	results;
+				std::exception_ptr			error;
+			};
+
+			/// Called by the worker threads once a frame from @ref add_frame() has been processed.
+			void frame_done(const size_t sequence, cv::Mat frame, const DarkHelp::PredictionResults & results, std::exception_ptr error);
+
+			/// Forget about all frames which have not yet been delivered.  @see @ref purge() @see @ref stop()
+			void reset_frames();
+
+			/// Discard all images and files which are waiting to be processed.  @see @ref purge() @see @ref stop()
+			void discard_input();
+
+			/// Wake up any thread waiting on the given condition variable.  Does nothing if nobody is waiting.
+			void wake(std::condition_variable & cv, const std::atomic<size_t> & waiting, const bool everyone);
+
+			/// The method that each neural network worker thread runs to process images.  @see @ref restart()
 			void run(const size_t id);
 
 			/// If the threads need to stop, set this variable to @p true.  @see @ref stop()
 			std::atomic<bool> stop_requested;
 
+			/** The number of neural network worker threads which have not exited.  If this drops to zero, for example because
+			 * the neural network failed to load, then nothing will ever be taken out of the queues.
+			 */
+			std::atomic<size_t> workers_running;
+
+			/// Returns @p true if the threads have been stopped or if all the neural network worker threads have exited.
+			bool workers_stopped() const
+			{
+				return stop_requested or workers_running == 0;
+			}
+
 			/// The number of threads to start.
 			size_t worker_threads_to_start;
 
@@ -270,30 +541,84 @@ namespace DarkHelp
 			/// Address to the worker thread neural networks.  @see @ref get_nn()
 			std::vector<DarkHelp::NN *> networks;
 
-			/// @{ Used to signal the worker threads when more work becomes available.
-			std::condition_variable trigger;
+			/** Lock used with the condition variables below.  The queues themselves are lock-free, so this is only held to
+			 * go to sleep or to wake up a thread which is sleeping.  Each condition variable has a matching count of sleeping
+			 * threads so nobody is woken up unless they're waiting for that specific event.
+			 */
 			std::mutex trigger_lock;
+
+			/// @{ Used to signal the worker threads when more work becomes available.
+			std::condition_variable work_available;
+			std::atomic<size_t> workers_waiting;
+			/// @}
+
+			/// @{ Used to signal @ref add_image() and @ref add_images() when there is room in the queues.
+			std::condition_variable room_available;
+			std::atomic<size_t> producers_waiting;
+			/// @}
+
+			/// @{ Used to signal @ref wait_for_results() when all images have been processed.
+			std::condition_variable work_done;
+			std::atomic<size_t> results_waiting;
+			/// @}
+
+			/// @{ Used to signal the @ref decode_threads when more files become available.
+			std::condition_variable files_available;
+			std::atomic<size_t> decoders_waiting;
+			/// @}
+
+			/// @{ Used to signal the @ref output_threads when more annotated images become available.
+			std::condition_variable output_available;
+			std::atomic<size_t> writers_waiting;
 			/// @}
 
 			/** Used to keep track of all the input @em files remaining to be processed.
-			 * @see @ref add_image()
 			 * @see @ref add_images()
-			 * @see @ref input_image_and_file_lock
+			 * @see @ref max_queued_files
 			 */
-			std::deque<std::string> input_files;
+			std::unique_ptr<BoundedQueue<std::string>> input_files;
 
 			/** Used to keep track of all the input @em images remaining to be processed.
 			 * @see @ref add_image()
-			 * @see @ref add_images()
-			 * @see @ref input_image_and_file_lock
+			 * @see @ref max_queued_images
+			 */
+			std::unique_ptr<BoundedQueue<QueuedImage>> input_images;
+
+			/// Images which have been decoded by the @ref decode_threads and are waiting for the neural network.  @see @ref max_decoded_images
+			std::unique_ptr<BoundedQueue<QueuedImage>> decoded_images;
+
+			/// Annotated images waiting for the @ref output_threads.  @see @ref max_output_images
+			std::unique_ptr<BoundedQueue<OutputFile>> output_files;
+
+			/** @{ The number of items in each queue.  These are incremented @em before an item is added to the queue and
+			 * decremented @em after an item is removed, so they never under-count.  Items in @ref decoded_images and
+			 * @ref output_files are also counted by @ref files_processing.
 			 */
-			std::map<std::string, cv::Mat> input_images;
+			std::atomic<size_t> files_queued;
+			std::atomic<size_t> images_queued;
+			std::atomic<size_t> decoded_queued;
+			std::atomic<size_t> output_queued;
+			/// @}
+
+			/** @{ The smallest size the @ref decode_threads can use when decoding JPEG images at a reduced resolution.  This is
+			 * set once a neural network has been loaded, and only if @ref DarkHelp::Config::reduced_resolution_decode is set.
+			 * @see @ref DarkHelp::read_image()
+			 */
+			std::atomic<int> decode_minimum_width;
+			std::atomic<int> decode_minimum_height;
+			/// @}
 
 			/// Used by @ref add_image() to generate an image filename.
 			std::atomic<size_t> input_image_index;
 
-			/// Lock used to protect access to @em both @ref input_files and @ref input_images.
-			std::mutex input_image_and_file_lock;
+			/// @{ Used by @ref add_frame() to deliver the results in frame order.  All of these are protected by @p frames_lock.
+			std::mutex frames_lock;
+			std::condition_variable frames_delivered;
+			std::map<size_t, ReorderedFrame> reordered_frames;
+			size_t next_frame_sequence;
+			size_t next_frame_to_deliver;
+			bool delivering_frames;
+			/// @}
 
 			/// @{ The prediction results for all the image file which have been processed.  @see @ref get_results()
 			ResultsMap all_results;
@@ -303,7 +628,7 @@ namespace DarkHelp
 			/// Track the number of worker threads which have loaded the neural network.
 			std::atomic<size_t> threads_ready;
 
-			/// The number of worker threads which are currently processing an image.
+			/// The number of images which have been removed from the input queues but have not yet made it through all the stages.
 			std::atomic<size_t> files_processing;
 	};
 }
@@ -5,6 +5,8 @@
 
 #include "DarkHelp.hpp"
 
+#include <fstream>
+#include <numeric>
 #include <regex>
 #include <sys/stat.h>
 
@@ -361,10 +363,10 @@ size_t DarkHelp::edit_cfg_file(const std::string & cfg_filename, DarkHelp::MStr
 	if (m.size()				== 2	and
 		m.count("batch")		== 1	and
 		m.count("subdivisions")	== 1	and
-		m["batch"]				== "1"	and
 		m["subdivisions"]		== "1"	)
 	{
 		// we need to know if this is the initial batch/subdivisions modification performed by init()
+		// (note the batch size is not necessarily "1" since it comes from DarkHelp::Config::batch_size)
 		// because there are cases were we'll need to abort modifying the .cfg file if this is the case
 		initial_modification = true;
 	}
@@ -495,16 +497,155 @@ cv::Mat DarkHelp::resize_keeping_aspect_ratio(cv::Mat mat, const cv::Size & desi
 		return cv::Mat();
 	}
 
-	const double image_width		= static_cast<double>(mat.cols);
-	const double image_height		= static_cast<double>(mat.rows);
+	return slow_resize_ignore_aspect_ratio(mat, size_keeping_aspect_ratio(mat.size(), desired_size));
+}
+
+
+cv::Size DarkHelp::size_keeping_aspect_ratio(const cv::Size & image_size, const cv::Size & desired_size)
+{
+	if (image_size.area() <= 0 or desired_size.width < 1 or desired_size.height < 1)
+	{
+		return cv::Size(0, 0);
+	}
+
+	const double image_width		= static_cast<double>(image_size.width);
+	const double image_height		= static_cast<double>(image_size.height);
 	const double horizontal_factor	= image_width	/ static_cast<double>(desired_size.width);
 	const double vertical_factor	= image_height	/ static_cast<double>(desired_size.height);
 	const double largest_factor 	= std::max(horizontal_factor, vertical_factor);
 	const double new_width			= image_width	/ largest_factor;
 	const double new_height			= image_height	/ largest_factor;
-	const cv::Size new_size(std::round(new_width), std::round(new_height));
 
-	return slow_resize_ignore_aspect_ratio(mat, new_size);
+	return cv::Size(std::round(new_width), std::round(new_height));
+}
+
+
+cv::Size DarkHelp::jpeg_image_size(const std::string & filename)
+{
+	std::ifstream ifs(filename, std::ifstream::in | std::ifstream::binary);
+
+	const auto read_byte = [&ifs]() -> int
+	{
+		return ifs.get();
+	};
+
+	const auto read_word = [&]() -> int
+	{
+		const int hi = read_byte();
+		const int lo = read_byte();
+		return (hi << 8) | lo;
+	};
+
+	// every JPEG file starts with the SOI marker
+	if (read_byte() != 0xff or read_byte() != 0xd8)
+	{
+		return cv::Size(0, 0);
+	}
+
+	while (ifs.good())
+	{
+		// skip to the next marker, ignoring any fill bytes
+		int marker = read_byte();
+		if (marker != 0xff)
+		{
+			break;
+		}
+		while (marker == 0xff)
+		{
+			marker = read_byte();
+		}
+
+		if (marker == 0xd9 or marker == 0xda or marker == EOF)
+		{
+			// end of image or start of scan, meaning there was no frame header
+			break;
+		}
+
+		if (marker == 0x01 or (marker >= 0xd0 and marker <= 0xd7))
+		{
+			// these markers have no length
+			continue;
+		}
+
+		const int length = read_word();
+		if (length < 2)
+		{
+			break;
+		}
+
+		// SOF0 - SOF15 contain the image size, except for DHT (C4), JPG (C8), and DAC (CC) which share the same range
+		if (marker >= 0xc0 and marker <= 0xcf and marker != 0xc4 and marker != 0xc8 and marker != 0xcc)
+		{
+			read_byte(); // precision
+			const int height	= read_word();
+			const int width		= read_word();
+
+			if (ifs.good() and width > 0 and height > 0)
+			{
+				return cv::Size(width, height);
+			}
+			break;
+		}
+
+		ifs.seekg(length - 2, std::ios_base::cur);
+	}
+
+	return cv::Size(0, 0);
+}
+
+
+cv::Mat DarkHelp::read_image(const std::string & filename, const cv::Size & minimum_size, cv::Size & original_size)
+{
+	original_size = cv::Size(0, 0);
+
+	cv::Size jpeg_size(0, 0);
+	int factor = 1;
+	if (minimum_size.width > 0 and minimum_size.height > 0)
+	{
+		jpeg_size = jpeg_image_size(filename);
+
+		// we don't yet know if the image will be rotated because of EXIF, so the shortest side of the image has to be
+		// at least as large as the longest side of the minimum size
+		const int shortest_side	= std::min(jpeg_size.width, jpeg_size.height);
+		const int longest_side	= std::max(minimum_size.width, minimum_size.height);
+		while (factor < 8 and shortest_side / (factor * 2) >= longest_side)
+		{
+			factor *= 2;
+		}
+	}
+
+	int flags = cv::IMREAD_COLOR;
+	switch (factor)
+	{
+		case 2: flags = cv::IMREAD_REDUCED_COLOR_2; break;
+		case 4: flags = cv::IMREAD_REDUCED_COLOR_4; break;
+		case 8: flags = cv::IMREAD_REDUCED_COLOR_8; break;
+		default: break;
+	}
+
+	cv::Mat mat = cv::imread(filename, flags);
+	if (mat.empty() or factor == 1)
+	{
+		original_size = mat.size();
+		return mat;
+	}
+
+	// the JPEG decoder rounds up the reduced size, and the image may also have been rotated because of EXIF
+	const cv::Size reduced_size((jpeg_size.width + factor - 1) / factor, (jpeg_size.height + factor - 1) / factor);
+	if (mat.size() == reduced_size)
+	{
+		original_size = jpeg_size;
+	}
+	else if (mat.cols == reduced_size.height and mat.rows == reduced_size.width)
+	{
+		original_size = cv::Size(jpeg_size.height, jpeg_size.width);
+	}
+	else
+	{
+		original_size = cv::Size(mat.cols * factor, mat.rows * factor);
+	}
+
+	return mat;
 }
 
 
@@ -516,6 +657,25 @@ cv::Mat DarkHelp::fast_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv:
 	}
 
 	cv::Mat resized_image;
+	fast_resize_ignore_aspect_ratio(mat, desired_size, resized_image);
+
+	return resized_image;
+}
+
+
+void DarkHelp::fast_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv::Size & desired_size, cv::Mat & dst)
+{
+	if (mat.empty())
+	{
+		dst.release();
+		return;
+	}
+
+	if (mat.size() == desired_size)
+	{
+		mat.copyTo(dst);
+		return;
+	}
 
 	// INTER_NEAREST is the fastest resize method at a cost of quality, but since we're making the image match the
 	// network dimensions (416x416, etc) we're (probably!?) aiming for speed, not quality.
@@ -529,17 +689,17 @@ cv::Mat DarkHelp::fast_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv:
 
 		gpu_original_image.upload(mat);
 		cv::cuda::resize(gpu_original_image, gpu_resized_image, desired_size, 0.0, 0.0, cv::INTER_NEAREST);
-		gpu_resized_image.download(resized_image);
+		gpu_resized_image.download(dst);
 
 	#else
 
 		// otherwise we don't have a GPU to use so call the "normal" CPU version of cv::resize()
 
-		cv::resize(mat, resized_image, desired_size, cv::INTER_NEAREST);
+		cv::resize(mat, dst, desired_size, cv::INTER_NEAREST);
 
 	#endif
 
-	return resized_image;
+	return;
 }
 
 
@@ -550,10 +710,26 @@ cv::Mat DarkHelp::slow_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv:
 		return mat;
 	}
 
-	if (desired_size.width < 1 or desired_size.height < 1)
+	cv::Mat dst;
+	slow_resize_ignore_aspect_ratio(mat, desired_size, dst);
+
+	return dst;
+}
+
+
+void DarkHelp::slow_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv::Size & desired_size, cv::Mat & dst)
+{
+	if (mat.empty() or desired_size.width < 1 or desired_size.height < 1)
 	{
 		// return an empty image
-		return cv::Mat();
+		dst.release();
+		return;
+	}
+
+	if (mat.size() == desired_size)
+	{
+		mat.copyTo(dst);
+		return;
 	}
 
 	/* See the cv::resize() docs, which states:
@@ -568,10 +744,213 @@ cv::Mat DarkHelp::slow_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv:
 		interpolation = cv::InterpolationFlags::INTER_CUBIC; // image needs to grow
 	}
 
-	cv::Mat dst;
 	cv::resize(mat, dst, desired_size, 0, 0, interpolation);
 
-	return dst;
+	return;
+}
+
+
+/* The conversion from an interleaved 8-bit BGR image to Darknet's planar RGB float format is done for every image, so
+ * it has SSE4.1 and AVX2 versions which are selected at runtime.  Both versions use the same SSSE3 shuffles to split
+ * 16 pixels (48 bytes) into separate B, G, and R registers; they only differ in how the bytes are widened to floats.
+ */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#define DARKHELP_X86_SIMD
+	#include <immintrin.h>
+	#if defined(__GNUC__) || defined(__clang__)
+		#define DARKHELP_TARGET(t) __attribute__((target(t)))
+	#else
+		#define DARKHELP_TARGET(t)
+	#endif
+#endif
+
+
+namespace
+{
+	constexpr float one_over_255 = 1.0f / 255.0f;
+
+	/// Convert a single row one pixel at a time.  Used for images without SIMD support, and for the last few pixels of each row.
+	inline void convert_row_to_planar_scalar(const uint8_t * src, const int channels, const int first_column, const int last_column, float * const * planes)
+	{
+		for (int x = first_column; x < last_column; x ++)
+		{
+			const uint8_t * pixel = src + x * channels;
+			for (int c = 0; c < channels; c ++)
+			{
+				planes[c][x] = pixel[c] * one_over_255;
+			}
+		}
+
+		return;
+	}
+
+	#ifdef DARKHELP_X86_SIMD
+
+	/// Shuffle masks to extract the B, G, and R bytes from 3 consecutive 16-byte registers.  Indexed as [channel][register].
+	alignas(16) const int8_t deinterleave_masks[3][3][16] =
+	{
+		{	// blue
+			{ 0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+			{-1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14, -1, -1, -1, -1, -1},
+			{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1,  4,  7, 10, 13}
+		},
+		{	// green
+			{ 1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+			{-1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1},
+			{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14}
+		},
+		{	// red
+			{ 2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+			{-1, -1, -1, -1, -1,  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1},
+			{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15}
+		}
+	};
+
+	DARKHELP_TARGET("ssse3")
+	inline __m128i deinterleave_channel(const __m128i & a, const __m128i & b, const __m128i & c, const int channel)
+	{
+		const auto & m = deinterleave_masks[channel];
+		return _mm_or_si128(
+				_mm_or_si128(
+					_mm_shuffle_epi8(a, _mm_load_si128(reinterpret_cast<const __m128i*>(m[0]))),
+					_mm_shuffle_epi8(b, _mm_load_si128(reinterpret_cast<const __m128i*>(m[1])))),
+				_mm_shuffle_epi8(c, _mm_load_si128(reinterpret_cast<const __m128i*>(m[2]))));
+	}
+
+	DARKHELP_TARGET("sse4.1")
+	void convert_bgr_row_to_planar_rgb_sse41(const uint8_t * src, const int width, float * const * planes)
+	{
+		const __m128 scale = _mm_set1_ps(one_over_255);
+
+		int x = 0;
+		for (; x + 16 <= width; x += 16)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3 +  0));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3 + 16));
+			const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3 + 32));
+
+			// note the channel swap:  BGR in the source image becomes RGB in the destination planes
+			for (int channel = 0; channel < 3; channel ++)
+			{
+				const __m128i v = deinterleave_channel(a, b, c, 2 - channel);
+				float * dst = planes[channel] + x;
+
+				_mm_storeu_ps(dst +  0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(v					)), scale));
+				_mm_storeu_ps(dst +  4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v,  4))), scale));
+				_mm_storeu_ps(dst +  8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v,  8))), scale));
+				_mm_storeu_ps(dst + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12))), scale));
+			}
+		}
+
+		if (x < width)
+		{
+			float * const swapped[3] = {planes[2], planes[1], planes[0]};
+			convert_row_to_planar_scalar(src, 3, x, width, swapped);
+		}
+
+		return;
+	}
+
+	DARKHELP_TARGET("avx2")
+	void convert_bgr_row_to_planar_rgb_avx2(const uint8_t * src, const int width, float * const * planes)
+	{
+		const __m256 scale = _mm256_set1_ps(one_over_255);
+
+		int x = 0;
+		for (; x + 16 <= width; x += 16)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3 +  0));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3 + 16));
+			const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3 + 32));
+
+			// note the channel swap:  BGR in the source image becomes RGB in the destination planes
+			for (int channel = 0; channel < 3; channel ++)
+			{
+				const __m128i v = deinterleave_channel(a, b, c, 2 - channel);
+				float * dst = planes[channel] + x;
+
+				_mm256_storeu_ps(dst + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v					)), scale));
+				_mm256_storeu_ps(dst + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8))), scale));
+			}
+		}
+
+		if (x < width)
+		{
+			float * const swapped[3] = {planes[2], planes[1], planes[0]};
+			convert_row_to_planar_scalar(src, 3, x, width, swapped);
+		}
+
+		return;
+	}
+
+	#endif
+}
+
+
+void DarkHelp::convert_mat_to_planar_rgb(const cv::Mat & mat, float * dst)
+{
+	if (mat.depth() != CV_8U or mat.channels() > 4)
+	{
+		/// @throw std::invalid_argument if the image is not an 8-bit image with at most 4 channels.
+		throw std::invalid_argument("cannot convert image of type " + std::to_string(mat.type()) + " to planar RGB");
+	}
+
+	const int width		= mat.cols;
+	const int height	= mat.rows;
+	const int channels	= mat.channels();
+	const size_t area	= static_cast<size_t>(width) * height;
+
+	#ifdef DARKHELP_X86_SIMD
+	using RowFunction = void(*)(const uint8_t *, const int, float * const *);
+	static const RowFunction simd_row_function =
+			cv::checkHardwareSupport(CV_CPU_AVX2)	? convert_bgr_row_to_planar_rgb_avx2	:
+			cv::checkHardwareSupport(CV_CPU_SSE4_1)	? convert_bgr_row_to_planar_rgb_sse41	:
+			nullptr;
+	#endif
+
+	for (int y = 0; y < height; y ++)
+	{
+		const uint8_t * src = mat.ptr<uint8_t>(y);
+
+		float * planes[4];
+		for (int c = 0; c < channels; c ++)
+		{
+			planes[c] = dst + c * area + static_cast<size_t>(y) * width;
+		}
+
+		if (channels == 3)
+		{
+			#ifdef DARKHELP_X86_SIMD
+			if (simd_row_function)
+			{
+				simd_row_function(src, width, planes);
+				continue;
+			}
+			#endif
+
+			// OpenCV uses BGR, but Darknet expects RGB
+			std::swap(planes[0], planes[2]);
+		}
+
+		convert_row_to_planar_scalar(src, channels, 0, width, planes);
+	}
+
+	return;
+}
+
+
+void DarkHelp::convert_mat_to_planar_rgb(const cv::Mat & mat, VFloat & dst)
+{
+	// the buffer is only ever grown, so when it is re-used for images of the same size there is no new allocation
+	const size_t len = mat.total() * mat.channels();
+	if (dst.size() < len)
+	{
+		dst.resize(len);
+	}
+
+	convert_mat_to_planar_rgb(mat, dst.data());
+
+	return;
 }
 
 
@@ -720,138 +1099,547 @@ std::string DarkHelp::yolo_save_annotations(const std::string & filename, const
 }
 
 
-void DarkHelp::pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const int size)
+namespace
 {
+	/// Colours are combined into buckets of this size when looking for the dominant colour.
+	const int pixelate_bucket = 4;
+
+	/// The number of buckets per channel, which includes a bucket for values which round up to 256.
+	const int pixelate_buckets = 256 / pixelate_bucket + 1;
+
+	/// Determine if the rectangle can be pixelated.  Rectangles (and cells) which go beyond the image are skipped.
+	bool can_pixelate(const cv::Mat & src, const cv::Rect & r, const int size)
+	{
+		return not (src.empty()					or
+					r.area() <= 0				or
+					r.x < 0						or
+					r.y < 0						or
+					r.x + r.width	> src.cols	or
+					r.y + r.height	> src.rows	or
+					size < 5);
+	}
+
+	/// If the rectangle is too big, then we need to split it up into smaller pieces we call "cells".
+	void get_pixelate_cells(const cv::Mat & src, const cv::Rect & r, const int size, DarkHelp::VRect & cells)
+	{
+		if (not can_pixelate(src, r, size))
+		{
+			return;
+		}
+
+		if (r.width >= (size * 2) or r.height >= (size * 2))
+		{
+			const float cell_cols	= std::ceil(r.width		/ static_cast<float>(size));
+			const float cell_rows	= std::ceil(r.height	/ static_cast<float>(size));
+			const float cell_width	= r.width	/ cell_cols;
+			const float cell_height	= r.height	/ cell_rows;
+
+			for (int y = 0; y < cell_rows; y ++)
+			{
+				for (int x = 0; x < cell_cols; x ++)
+				{
+					cv::Rect cell;
+					cell.x		= std::floor(r.x + x * cell_width);
+					cell.y		= std::floor(r.y + y * cell_height);
+					cell.width	= std::ceil(cell_width);
+					cell.height	= std::ceil(cell_height);
+
+					get_pixelate_cells(src, cell, size, cells);
+				}
+			}
+
+			return;
+		}
+
+		cells.push_back(r);
+
+		return;
+	}
+
+	/** Get the dominant colour (not the average!) within this cell.  Each channel is rounded to the nearest bucket, and
+	 * the buckets are counted in a fixed-size histogram.  Only the entries which were used are reset afterwards, so the
+	 * cost depends on the size of the cell and not the size of the histogram.  When several colours are used the same
+	 * number of times, the one with the lowest blue-green-red value is chosen.
+	 */
+	cv::Vec3b get_dominant_colour(const cv::Mat & src, const cv::Rect & r)
+	{
+		thread_local std::vector<uint32_t> histogram(pixelate_buckets * pixelate_buckets * pixelate_buckets, 0);
+		thread_local DarkHelp::VInt used;
+
+		used.clear();
+		for (int row = r.y; row < r.y + r.height; row ++)
+		{
+			const uint8_t * ptr = src.ptr<uint8_t>(row) + 3 * r.x;
+
+			for (int col = 0; col < r.width; col ++)
+			{
+				const int blue	= (ptr[0] + pixelate_bucket / 2) / pixelate_bucket;
+				const int green	= (ptr[1] + pixelate_bucket / 2) / pixelate_bucket;
+				const int red	= (ptr[2] + pixelate_bucket / 2) / pixelate_bucket;
+				ptr += 3;
+
+				const int idx = (blue * pixelate_buckets + green) * pixelate_buckets + red;
+				if (histogram[idx] == 0)
+				{
+					used.push_back(idx);
+				}
+				histogram[idx] ++;
+			}
+		}
+
+		int best_idx = 0;
+		uint32_t best_count = 0;
+		for (const int idx : used)
+		{
+			const uint32_t count = histogram[idx];
+			if (count > best_count or (count == best_count and idx < best_idx))
+			{
+				best_idx	= idx;
+				best_count	= count;
+			}
+			histogram[idx] = 0;
+		}
+
+		const auto colour = [](const int bucket)
+		{
+			return static_cast<uint8_t>(std::min(255, bucket * pixelate_bucket));
+		};
+
+		return cv::Vec3b(
+			colour(best_idx / (pixelate_buckets * pixelate_buckets)),
+			colour(best_idx / pixelate_buckets % pixelate_buckets),
+			colour(best_idx % pixelate_buckets));
+	}
+
+	/** Pixelate a rectangle by shrinking it down to 1 pixel per cell, and then growing it back to the original size.
+	 * The pixels are read from @p src_rect, which is normally the same as @p r unless @p src is a copy of part of the image.
+	 */
+	void mosaic_rectangle(const cv::Mat & src, const cv::Rect & src_rect, cv::Mat & dst, const cv::Rect & r, const int size)
+	{
+		int cell_cols = 1;
+		int cell_rows = 1;
+		if (r.width >= (size * 2) or r.height >= (size * 2))
+		{
+			cell_cols = std::ceil(r.width	/ static_cast<float>(size));
+			cell_rows = std::ceil(r.height	/ static_cast<float>(size));
+		}
+
+		cv::Mat cells;
+		cv::resize(src(src_rect), cells, cv::Size(cell_cols, cell_rows), 0.0, 0.0, cv::INTER_AREA);
+		cv::Mat output = dst(r);
+		cv::resize(cells, output, r.size(), 0.0, 0.0, cv::INTER_NEAREST);
+
+		return;
+	}
+
+	/// Pixelate all the rectangles.  The dominant colour of each cell is found in parallel, and then the cells are painted in order.
+	void pixelate(const cv::Mat & src, cv::Mat & dst, const DarkHelp::VRect & rects, const int size, const bool mosaic)
+	{
+		if (src.empty() or size < 5)
+		{
+			return;
+		}
+
+		DarkHelp::VRect cells;
+		DarkHelp::VRect mosaics;
+		for (const auto & r : rects)
+		{
+			if (not can_pixelate(src, r, size))
+			{
+				continue;
+			}
+
+			if (dst.size() != src.size())
+			{
+				dst = src.clone();
+			}
+
+			if (mosaic)
+			{
+				mosaics.push_back(r);
+			}
+			else
+			{
+				get_pixelate_cells(src, r, size, cells);
+			}
+		}
+
+		if (not mosaics.empty())
+		{
+			/* When pixelating in place, a rectangle which overlaps a previous one would read pixels which have already
+			 * been pixelated.  So the area covered by the overlapping rectangles is copied before anything is modified.
+			 */
+			cv::Rect overlapping;
+			if (src.data == dst.data)
+			{
+				for (size_t i = 0; i < mosaics.size(); i ++)
+				{
+					for (size_t j = i + 1; j < mosaics.size(); j ++)
+					{
+						if ((mosaics[i] & mosaics[j]).area() > 0)
+						{
+							const cv::Rect both = mosaics[i] | mosaics[j];
+							overlapping = (overlapping.area() > 0 ? (overlapping | both) : both);
+						}
+					}
+				}
+			}
+
+			cv::Mat original;
+			if (overlapping.area() > 0)
+			{
+				original = src(overlapping).clone();
+			}
+
+			for (const auto & r : mosaics)
+			{
+				if (overlapping.area() > 0 and (overlapping & r) == r)
+				{
+					mosaic_rectangle(original, r - overlapping.tl(), dst, r, size);
+				}
+				else
+				{
+					mosaic_rectangle(src, r, dst, r, size);
+				}
+			}
+		}
+
+		if (cells.empty())
+		{
+			return;
+		}
+
+		std::vector<cv::Vec3b> colours(cells.size());
+		cv::parallel_for_(cv::Range(0, cells.size()),
+				[&](const cv::Range & range)
+				{
+					for (int idx = range.start; idx < range.end; idx ++)
+					{
+						colours[idx] = get_dominant_colour(src, cells[idx]);
+					}
+				} );
+
+		// cells from different rectangles may overlap, so painting is done in the same order as the rectangles
+		for (size_t idx = 0; idx < cells.size(); idx ++)
+		{
+			dst(cells[idx]).setTo(cv::Scalar(colours[idx][0], colours[idx][1], colours[idx][2]));
+		}
+
+		return;
+	}
+}
+
+
+void DarkHelp::pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const int size, const bool mosaic)
+{
+	VRect rects;
+	rects.reserve(prediction_results.size());
 	for (const auto & p : prediction_results)
 	{
-		pixelate_rectangle(src, dst, p.rect, size);
+		rects.push_back(p.rect);
 	}
 
+	pixelate(src, dst, rects, size, mosaic);
+
 	return;
 }
 
 
-void DarkHelp::pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const std::set<int> & class_filter, const int size)
+void DarkHelp::pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const std::set<int> & class_filter, const int size, const bool mosaic)
 {
+	VRect rects;
+	rects.reserve(prediction_results.size());
 	for (const auto & p : prediction_results)
 	{
 		if (class_filter.empty() or class_filter.count(p.best_class) > 0)
 		{
-			pixelate_rectangle(src, dst, p.rect, size);
+			rects.push_back(p.rect);
 		}
 	}
 
+	pixelate(src, dst, rects, size, mosaic);
+
 	return;
 }
 
 
-void DarkHelp::pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const VRect & rects, const int size)
+void DarkHelp::pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const VRect & rects, const int size, const bool mosaic)
 {
-	for (const auto & r : rects)
-	{
-		pixelate_rectangle(src, dst, r, size);
-	}
+	pixelate(src, dst, rects, size, mosaic);
 
 	return;
 }
 
 
-void DarkHelp::pixelate_rectangle(const cv::Mat & src, cv::Mat & dst, const cv::Rect & r, const int size)
+void DarkHelp::pixelate_rectangle(const cv::Mat & src, cv::Mat & dst, const cv::Rect & r, const int size, const bool mosaic)
 {
-	if (src.empty()					or
-		r.area() <= 0				or
-		r.x < 0						or
-		r.y < 0						or
-		r.x + r.width	> src.cols	or
-		r.y + r.height	> src.rows	or
-		size < 5)
-	{
-		return;
-	}
+	pixelate(src, dst, {r}, size, mosaic);
 
-	if (dst.size() != src.size())
-	{
-		dst = src.clone();
-	}
+	return;
+}
 
-	// if the rectangle is too big, then we need to split it up into smaller pieces we call "cells"
-	if (r.width >= (size * 2) or r.height >= (size * 2))
+
+namespace
+{
+	/// Boxes are converted to this "structure of arrays" so the overlap calculations only touch the values they need.
+	struct NMSBoxes
 	{
-		const float cell_cols	= std::ceil(r.width		/ static_cast<float>(size));
-		const float cell_rows	= std::ceil(r.height	/ static_cast<float>(size));
-		const float cell_width	= r.width	/ cell_cols;
-		const float cell_height	= r.height	/ cell_rows;
+		DarkHelp::VFloat x1;
+		DarkHelp::VFloat y1;
+		DarkHelp::VFloat x2;
+		DarkHelp::VFloat y2;
+		DarkHelp::VFloat area;
 
-		for (int y = 0; y < cell_rows; y ++)
+		template <typename T>
+		NMSBoxes(const std::vector<cv::Rect_<T>> & rects)
 		{
-			for (int x = 0; x < cell_cols; x ++)
+			const size_t count = rects.size();
+			x1	.resize(count);
+			y1	.resize(count);
+			x2	.resize(count);
+			y2	.resize(count);
+			area.resize(count);
+
+			for (size_t idx = 0; idx < count; idx ++)
 			{
-				cv::Rect cell;
-				cell.x		= std::floor(r.x + x * cell_width);
-				cell.y		= std::floor(r.y + y * cell_height);
-				cell.width	= std::ceil(cell_width);
-				cell.height	= std::ceil(cell_height);
-
-				pixelate_rectangle(src, dst, cell, size);
+				const auto & r = rects[idx];
+				x1	[idx] = r.x;
+				y1	[idx] = r.y;
+				x2	[idx] = r.x + r.width;
+				y2	[idx] = r.y + r.height;
+				area[idx] = static_cast<float>(r.width) * static_cast<float>(r.height);
 			}
 		}
+	};
 
-		return;
-	}
-
-	// get the dominant colour (not the average!) within this square
-	struct comp
+	DarkHelp::VInt non_maximal_suppression(const NMSBoxes & boxes, const DarkHelp::VFloat & scores, const DarkHelp::VInt & classes, const float threshold, const bool class_agnostic, DarkHelp::VInt * suppressed_by)
 	{
-		bool operator() (const cv::Scalar & lhs, const cv::Scalar & rhs) const
+		const size_t count = scores.size();
+		if (boxes.x1.size() != count or (classes.size() != count and not classes.empty()))
+		{
+			/// @throw std::invalid_argument if the number of boxes, scores, and classes does not match.
+			throw std::invalid_argument("NMS requires the same number of boxes, scores, and classes");
+		}
+
+		const bool use_classes = (class_agnostic == false and classes.empty() == false);
+
+		if (suppressed_by)
 		{
-			for (size_t idx = 0; idx < 4; idx ++)
+			suppressed_by->assign(count, -1);
+		}
+
+		DarkHelp::VInt kept;
+		if (count == 0)
+		{
+			return kept;
+		}
+
+		// boxes are processed from highest score to lowest score
+		DarkHelp::VInt order(count);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(),
+				[&scores](const int lhs, const int rhs)
+				{
+					return scores[lhs] > scores[rhs];
+				});
+
+		/* Instead of comparing each box against every box that has been kept so far, each kept box is placed in the grid
+		 * cell which contains its centre.  Two boxes can only overlap if their centres are closer than half the size of
+		 * both boxes, so we only need to look at the cells within that distance, using the largest box kept so far.
+		 * The size of the cells is based on the average box size, and the grid is limited to 256x256 cells regardless of
+		 * how spread out the boxes may be.
+		 */
+		const float min_x = *std::min_element(boxes.x1.begin(), boxes.x1.end());
+		const float min_y = *std::min_element(boxes.y1.begin(), boxes.y1.end());
+		const float max_x = *std::max_element(boxes.x2.begin(), boxes.x2.end());
+		const float max_y = *std::max_element(boxes.y2.begin(), boxes.y2.end());
+
+		double total_size = 0.0;
+		for (size_t idx = 0; idx < count; idx ++)
+		{
+			total_size += std::max(boxes.x2[idx] - boxes.x1[idx], boxes.y2[idx] - boxes.y1[idx]);
+		}
+
+		const int max_cells = 256;
+		float cell_size = std::max({static_cast<float>(total_size / count), (max_x - min_x) / (max_cells - 1), (max_y - min_y) / (max_cells - 1)});
+		if (cell_size <= 0.0f)
+		{
+			cell_size = 1.0f;
+		}
+		const int columns	= std::min(max_cells, 1 + static_cast<int>((max_x - min_x) / cell_size));
+		const int rows		= std::min(max_cells, 1 + static_cast<int>((max_y - min_y) / cell_size));
+
+		std::vector<DarkHelp::VInt> grid(columns * rows);
+
+		const auto column_of = [&](const float x) { return std::clamp(static_cast<int>((x - min_x) / cell_size), 0, columns	- 1); };
+		const auto row_of    = [&](const float y) { return std::clamp(static_cast<int>((y - min_y) / cell_size), 0, rows	- 1); };
+
+		// half the width and height of the largest boxes kept so far
+		float max_half_width	= 0.0f;
+		float max_half_height	= 0.0f;
+
+		for (const int idx : order)
+		{
+			const float x1		= boxes.x1	[idx];
+			const float y1		= boxes.y1	[idx];
+			const float x2		= boxes.x2	[idx];
+			const float y2		= boxes.y2	[idx];
+			const float area	= boxes.area[idx];
+
+			const float cx			= (x1 + x2) / 2.0f;
+			const float cy			= (y1 + y2) / 2.0f;
+			const float half_width	= (x2 - x1) / 2.0f;
+			const float half_height	= (y2 - y1) / 2.0f;
+
+			const int first_column	= column_of	(cx - half_width	- max_half_width	);
+			const int last_column	= column_of	(cx + half_width	+ max_half_width	);
+			const int first_row		= row_of	(cy - half_height	- max_half_height	);
+			const int last_row		= row_of	(cy + half_height	+ max_half_height	);
+
+			int suppressor = -1;
+			for (int row = first_row; row <= last_row and suppressor < 0; row ++)
+			{
+				for (int column = first_column; column <= last_column and suppressor < 0; column ++)
+				{
+					for (const int k : grid[row * columns + column])
+					{
+						if (use_classes and classes[k] != classes[idx])
+						{
+							continue;
+						}
+
+						const float w = std::min(x2, boxes.x2[k]) - std::max(x1, boxes.x1[k]);
+						const float h = std::min(y2, boxes.y2[k]) - std::max(y1, boxes.y1[k]);
+						if (w <= 0.0f or h <= 0.0f)
+						{
+							continue;
+						}
+
+						const float intersection	= w * h;
+						const float iou				= intersection / (area + boxes.area[k] - intersection);
+						if (iou > threshold)
+						{
+							suppressor = k;
+							break;
+						}
+					}
+				}
+			}
+
+			if (suppressor >= 0)
 			{
-				if (lhs[idx] != rhs[idx])
+				if (suppressed_by)
 				{
-					return lhs[idx] < rhs[idx];
+					(*suppressed_by)[idx] = suppressor;
 				}
+				continue;
+			}
+
+			kept.push_back(idx);
+			if (suppressed_by)
+			{
+				(*suppressed_by)[idx] = idx;
 			}
 
-			return false;
+			grid[row_of(cy) * columns + column_of(cx)].push_back(idx);
+			max_half_width	= std::max(max_half_width	, half_width	);
+			max_half_height	= std::max(max_half_height	, half_height	);
 		}
-	};
-	std::map<cv::Scalar, std::size_t, comp> m;
 
-	// the larger the bucket, the more we'll combine colours together
-	const float bucket = 4.0f;
+		return kept;
+	}
+}
+
+
+DarkHelp::VInt DarkHelp::non_maximal_suppression(const VRect & rects, const VFloat & scores, const VInt & classes, const float threshold, const bool class_agnostic, VInt * suppressed_by)
+{
+	return ::non_maximal_suppression(NMSBoxes(rects), scores, classes, threshold, class_agnostic, suppressed_by);
+}
+
+
+DarkHelp::VInt DarkHelp::non_maximal_suppression(const VRect2d & rects, const VFloat & scores, const VInt & classes, const float threshold, const bool class_agnostic, VInt * suppressed_by)
+{
+	return ::non_maximal_suppression(NMSBoxes(rects), scores, classes, threshold, class_agnostic, suppressed_by);
+}
+
+
+void DarkHelp::fuse_predictions(PredictionResults & predictions, const cv::Size & image_size, const float threshold, const ETileFusion fusion, const bool class_agnostic)
+{
+	if (fusion == ETileFusion::kMergeEdges or predictions.size() < 2)
+	{
+		return;
+	}
+
+	VRect	rects	(predictions.size());
+	VFloat	scores	(predictions.size());
+	VInt	classes	(predictions.size());
+	for (size_t idx = 0; idx < predictions.size(); idx ++)
+	{
+		rects	[idx] = predictions[idx].rect;
+		scores	[idx] = predictions[idx].best_probability;
+		classes	[idx] = predictions[idx].best_class;
+	}
+
+	VInt suppressed_by;
+	const VInt kept = non_maximal_suppression(rects, scores, classes, threshold, class_agnostic, &suppressed_by);
 
-	for (int row = r.y; row < r.y + r.height; row ++)
+	if (fusion == ETileFusion::kWeightedBoxFusion)
 	{
-		auto ptr = src.ptr(row);
+		// each kept box becomes the average of all the boxes it suppressed, weighted by the probability of each box
+		std::vector<cv::Vec4d> sums(predictions.size(), cv::Vec4d(0.0, 0.0, 0.0, 0.0));
+		VFloat weights(predictions.size(), 0.0f);
 
-		for (int col = r.x; col < r.x + r.width; col ++)
+		for (size_t idx = 0; idx < predictions.size(); idx ++)
 		{
-			cv::Scalar colour;
-			for (int i = 0; i < 3; i ++)
+			const int target	= suppressed_by[idx];
+			const cv::Rect & r	= predictions[idx].rect;
+			const float w		= scores[idx];
+
+			sums[target] += cv::Vec4d(w * r.x, w * r.y, w * r.br().x, w * r.br().y);
+			weights[target] += w;
+
+			if (target != static_cast<int>(idx))
 			{
-				colour[i] = std::min(255.0f, std::round(ptr[3 * col + i] / bucket) * bucket);
+				// keep the highest probability seen for each class
+				auto & lhs = predictions[target].all_probabilities;
+				for (const auto & iter : predictions[idx].all_probabilities)
+				{
+					auto & val = lhs[iter.first];
+					val = std::max(val, iter.second);
+				}
 			}
+		}
 
-			m[colour] ++;
+		for (const int idx : kept)
+		{
+			if (weights[idx] > 0.0f)
+			{
+				const cv::Vec4d v = sums[idx] / weights[idx];
+				auto & pred = predictions[idx];
+				pred.rect = cv::Rect(cv::Point(std::round(v[0]), std::round(v[1])), cv::Point(std::round(v[2]), std::round(v[3])));
+
+				pred.original_point.x		= (static_cast<float>(pred.rect.x) + static_cast<float>(pred.rect.width	) / 2.0f) / static_cast<float>(image_size.width);
+				pred.original_point.y		= (static_cast<float>(pred.rect.y) + static_cast<float>(pred.rect.height) / 2.0f) / static_cast<float>(image_size.height);
+				pred.original_size.width	= static_cast<float>(pred.rect.width	) / static_cast<float>(image_size.width);
+				pred.original_size.height	= static_cast<float>(pred.rect.height	) / static_cast<float>(image_size.height);
+			}
 		}
 	}
 
-	// look through the map to see which colour is used the most
-	cv::Scalar colour;
-	size_t count = 0;
-	for (auto iter : m)
+	// remove the suppressed predictions in a single pass, keeping the original order of the remaining predictions
+	size_t number_of_predictions = 0;
+	for (size_t idx = 0; idx < predictions.size(); idx ++)
 	{
-		const cv::Scalar & first	= iter.first;
-		const size_t & second		= iter.second;
-
-		if (second > count)
+		if (suppressed_by[idx] == static_cast<int>(idx))
 		{
-			count = second;
-			colour = first;
+			if (number_of_predictions != idx)
+			{
+				predictions[number_of_predictions] = std::move(predictions[idx]);
+			}
+			number_of_predictions ++;
 		}
 	}
-
-	dst(r) = colour;
+	predictions.resize(number_of_predictions);
 
 	return;
 }
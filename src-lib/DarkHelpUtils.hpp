@@ -107,6 +107,42 @@ namespace DarkHelp
 	 */
 	cv::Mat resize_keeping_aspect_ratio(cv::Mat mat, const cv::Size & desired_size);
 
+	/** Determine the size that @ref DarkHelp::resize_keeping_aspect_ratio() would use, without resizing the image.
+	 * Returns an empty size if either of the sizes is invalid.
+	 *
+	 * @since 2026-10-17
+	 */
+	cv::Size size_keeping_aspect_ratio(const cv::Size & image_size, const cv::Size & desired_size);
+
+	/** Get the dimensions of a JPEG image by reading the frame header, without decoding the image.  Returns an empty
+	 * size if the file is not a JPEG image or the header cannot be found.
+	 *
+	 * @note This is the size stored in the JPEG file.  It does not take into account the EXIF orientation.
+	 *
+	 * @since 2026-10-17
+	 */
+	cv::Size jpeg_image_size(const std::string & filename);
+
+	/** Read an image from disk, decoding it at a reduced resolution when the image is much larger than needed.  If the
+	 * image is a JPEG file which is at least 2, 4, or 8 times larger than @p minimum_size, then the downscaling is done
+	 * by the JPEG decoder with @p cv::IMREAD_REDUCED_COLOR_2, @p _4, or @p _8, which is much faster and uses much less
+	 * memory than decoding the full image and resizing it afterwards.  The reduced image is never smaller than
+	 * @p minimum_size in either dimension.
+	 *
+	 * @param [in] filename The image to read.
+	 * @param [in] minimum_size The smallest size needed, such as the network dimensions.  If empty, the image is read at
+	 * full resolution.
+	 * @param [out] original_size The size of the image at full resolution.
+	 *
+	 * @returns The image, which may be smaller than @p original_size, or an empty image if it could not be read.
+	 *
+	 * @see @ref DarkHelp::Config::reduced_resolution_decode
+	 * @see @ref DarkHelp::NN::predict_reduced()
+	 *
+	 * @since 2026-10-17
+	 */
+	cv::Mat read_image(const std::string & filename, const cv::Size & minimum_size, cv::Size & original_size);
+
 	/** Resize the given image as quickly as possible to the given dimensions.  This will sacrifice quality for speed.
 	 * If OpenCV has been compiled with support for CUDA, then this will utilise the GPU to do the resizing.
 	 *
@@ -119,6 +155,14 @@ namespace DarkHelp
 	 */
 	cv::Mat fast_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv::Size & desired_size);
 
+	/** Similar to the other @ref DarkHelp::fast_resize_ignore_aspect_ratio(), but the resized image is written to @p dst.
+	 * If @p dst already has the right size and type then its memory is re-used instead of allocating a new image.
+	 * Unlike the other call, if the image is already the right size it will be copied to @p dst.
+	 *
+	 * @since 2026-10-17
+	 */
+	void fast_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv::Size & desired_size, cv::Mat & dst);
+
 	/** Similar to @ref DarkHelp::fast_resize_ignore_aspect_ratio() but uses OpenCV algorithms that result in better
 	 * quality images at a cost of slower speed.
 	 *
@@ -130,6 +174,35 @@ namespace DarkHelp
 	 */
 	cv::Mat slow_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv::Size & desired_size);
 
+	/** Similar to the other @ref DarkHelp::slow_resize_ignore_aspect_ratio(), but the resized image is written to @p dst.
+	 * If @p dst already has the right size and type then its memory is re-used instead of allocating a new image.
+	 *
+	 * @since 2026-10-17
+	 */
+	void slow_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv::Size & desired_size, cv::Mat & dst);
+
+	/** Convert an 8-bit OpenCV image to the planar float format used by Darknet.  The colour channels are swapped from
+	 * BGR to RGB, each value is scaled from 0-255 to 0.0-1.0, and the pixels are stored one channel plane after the other
+	 * instead of interleaved.  This is done in a single pass over the image, using AVX2 or SSE4.1 when the CPU supports
+	 * it.  Images with 1 or 4 channels are supported, but only 3-channel images are vectorized and have their channels
+	 * swapped.
+	 *
+	 * @param [in] mat The image to convert, normally already resized to the network dimensions.
+	 * @param [out] dst Must point to at least @p rows x @p cols x @p channels floats.
+	 *
+	 * When %DarkHelp is built with Darknet, this is also what is used to fill in the Darknet @p image structure.
+	 *
+	 * @since 2026-10-17
+	 */
+	void convert_mat_to_planar_rgb(const cv::Mat & mat, float * dst);
+
+	/** Similar to the other @ref DarkHelp::convert_mat_to_planar_rgb(), but the destination is a vector that is grown as
+	 * needed.  The vector is never shrunk, so it can be re-used from one image to the next without re-allocating memory.
+	 *
+	 * @since 2026-10-17
+	 */
+	void convert_mat_to_planar_rgb(const cv::Mat & mat, VFloat & dst);
+
 	/** Given an image filename, get the corresponding filename where the YOLO annotations should be saved.
 	 * This will be the same as the image filename but with a @p .txt file extension.
 	 * If the filename provided already ends in @p .txt, then the original filename will be returned.
@@ -210,7 +283,7 @@ namespace DarkHelp
 	 *
 	 * @since 2022-07-04
 	 */
-	void pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const int size = 15);
+	void pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const int size = 15, const bool mosaic = false);
 
 	/** Pixelate only the predictions where the class ID matches a value in the class filter.
 	 * If the class filter is empty then this will pixelate all predictions.
@@ -222,7 +295,7 @@ namespace DarkHelp
 	 *
 	 * @since 2022-07-04
 	 */
-	void pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const std::set<int> & class_filter, const int size = 15);
+	void pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const std::set<int> & class_filter, const int size = 15, const bool mosaic = false);
 
 	/** Pixelate all of the rectangles.
 	 * @see @ref DarkHelp::pixelate_rectangle()
@@ -231,7 +304,7 @@ namespace DarkHelp
 	 *
 	 * @since 2022-07-04
 	 */
-	void pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const VRect & rects, const int size = 15);
+	void pixelate_rectangles(const cv::Mat & src, cv::Mat & dst, const VRect & rects, const int size = 15, const bool mosaic = false);
 
 	/** Pixelate the given rectangle.
 	 *
@@ -240,6 +313,12 @@ namespace DarkHelp
 	 * The @p size determines the width and height of the cells that will be used to pixelate the rectangle.
 	 * If @p size is less than @p 5, no pixelation will take place.
 	 *
+	 * Each cell is normally filled with the dominant colour found within that cell.  When @p mosaic is set to
+	 * @p true, each cell is instead filled with the average colour of the cell, which is much faster to calculate.
+	 *
+	 * When pixelating many rectangles, call @ref DarkHelp::pixelate_rectangles() instead of this function since the
+	 * cells from all of the rectangles are then processed in parallel.
+	 *
 	 * Setting																	| Image
 	 * -------------------------------------------------------------------------|------
 	 * @p annotation_pixelate_enabled=false										| @image html pixelate_off.png
@@ -249,10 +328,11 @@ namespace DarkHelp
 	 *
 	 * @see @ref DarkHelp::Config::annotation_pixelate_enabled
 	 * @see @ref DarkHelp::Config::annotation_pixelate_size
+	 * @see @ref DarkHelp::Config::annotation_pixelate_mosaic
 	 *
 	 * @since 2022-07-04
 	 */
-	void pixelate_rectangle(const cv::Mat & src, cv::Mat & dst, const cv::Rect & r, const int size = 15);
+	void pixelate_rectangle(const cv::Mat & src, cv::Mat & dst, const cv::Rect & r, const int size = 15, const bool mosaic = false);
 
 	/** Toggle STDOUT and STDERR output redirection.
 	 *
@@ -271,6 +351,44 @@ namespace DarkHelp
 	 */
 	void toggle_output_redirection();
 
+	/** Fast non-maximal suppression.  Boxes are visited from highest score to lowest, and a box is kept unless it
+	 * overlaps a box that has already been kept by more than @p threshold (intersection-over-union).  The boxes that
+	 * have been kept are stored in a coarse grid, so each box is only compared against the nearby boxes instead of all
+	 * boxes.  This behaves like @p cv::dnn::NMSBoxes() but handles all classes in a single call.
+	 *
+	 * @param [in] rects The boxes to consider.
+	 * @param [in] scores The score for each box.  Must be the same size as @p rects.
+	 * @param [in] classes The class of each box.  Boxes only suppress other boxes of the same class unless
+	 * @p class_agnostic is set.  May be empty, in which case all boxes are considered to be the same class.
+	 * @param [in] threshold The intersection-over-union threshold, such as @ref DarkHelp::Config::non_maximal_suppression_threshold.
+	 * @param [in] class_agnostic When @p true, boxes may suppress other boxes regardless of the class.
+	 * @param [out] suppressed_by If not @p nullptr, this is set to the index of the box which suppressed each box.
+	 * Boxes which are kept refer to themselves.
+	 * @returns The indexes of the boxes which were kept, from highest score to lowest score.
+	 *
+	 * @since 2026-10-17
+	 */
+	VInt non_maximal_suppression(const VRect & rects, const VFloat & scores, const VInt & classes, const float threshold, const bool class_agnostic = false, VInt * suppressed_by = nullptr);
+
+	/// Same as the other @ref DarkHelp::non_maximal_suppression() but the boxes use @p double.  @since 2026-10-17
+	VInt non_maximal_suppression(const VRect2d & rects, const VFloat & scores, const VInt & classes, const float threshold, const bool class_agnostic = false, VInt * suppressed_by = nullptr);
+
+	/** Combine overlapping predictions, such as those found in the overlapping area between two image tiles.  The
+	 * predictions are compared using @ref DarkHelp::non_maximal_suppression() and the suppressed predictions are
+	 * removed.  With @ref DarkHelp::ETileFusion::kWeightedBoxFusion the remaining rectangles are also replaced by the
+	 * probability-weighted average of all the rectangles they suppressed, and the class probabilities are combined.
+	 * Nothing is done when @p fusion is @ref DarkHelp::ETileFusion::kMergeEdges, and
+	 * @ref DarkHelp::ETileFusion::kAutomatic is handled the same as @ref DarkHelp::ETileFusion::kNMS.  Predictions only suppress other
+	 * predictions of the same class unless @p class_agnostic is set.
+	 *
+	 * @note The names of the predictions are not modified.
+	 *
+	 * @see @ref DarkHelp::Config::tile_fusion
+	 *
+	 * @since 2026-10-17
+	 */
+	void fuse_predictions(PredictionResults & predictions, const cv::Size & image_size, const float threshold, const ETileFusion fusion, const bool class_agnostic = false);
+
 	/** Combine together the 3 files that make up a neural network, and obfuscate them using the given key phrase.
 	 * Normally, this is done using the @p DarkHelpCombine command line tool.
 	 *
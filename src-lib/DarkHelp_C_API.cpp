@@ -185,8 +185,8 @@ const char * GetPredictionResults(DarkHelpPtr ptr)
 		json["file"][0]["count"]				= nn->prediction_results.size();
 		json["file"][0]["duration"]				= nn->duration_string();
 		json["file"][0]["filename"]				= "unknown";
-		json["file"][0]["original_height"]		= nn->original_image.rows;
-		json["file"][0]["original_width"]		= nn->original_image.cols;
+		json["file"][0]["original_height"]		= nn->original_image_size.height;
+		json["file"][0]["original_width"]		= nn->original_image_size.width;
 		json["file"][0]["tiles"]["horizontal"]	= nn->horizontal_tiles;
 		json["file"][0]["tiles"]["vertical"]	= nn->vertical_tiles;
 		json["file"][0]["tiles"]["width"]		= nn->tile_size.width;
@@ -207,6 +207,9 @@ const char * GetPredictionResults(DarkHelpPtr ptr)
 		json["settings"]["snapping"]			= nn->config.snapping_enabled;
 		json["settings"]["output_redirection"]	= nn->config.redirect_darknet_output;
 
+		// the names may not have been built yet if lazy_prediction_names is enabled
+		nn->name_predictions();
+
 		const auto & results = nn->prediction_results;
 		for (size_t idx = 0; idx < results.size(); idx ++)
 		{
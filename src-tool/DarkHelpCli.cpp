@@ -921,6 +921,7 @@ void process_video(Options & options)
 	size_t number_of_frames = 0;
 	const size_t rounded_fps = std::round(input_fps);
 	const auto start_time = std::chrono::high_resolution_clock::now();
+	cv::Mat annotated_frame;
 	while (signal_raised == false)
 	{
 		cv::Mat frame;
@@ -962,12 +963,13 @@ void process_video(Options & options)
 			options.nn.duration = average;
 		}
 
-		frame = options.nn.annotate();
-
+		// annotate directly at the output size, and re-use the same annotated image for every frame
+		cv::Size annotated_size(0, 0);
 		if (options.size2_is_set)
 		{
-			frame = DarkHelp::resize_keeping_aspect_ratio(frame, options.size2);
+			annotated_size = DarkHelp::size_keeping_aspect_ratio(frame.size(), options.size2);
 		}
+		frame = options.nn.annotate(annotated_frame, annotated_size);
 
 		number_of_frames ++;
 		output_video.write(frame);
@@ -1092,12 +1094,16 @@ void process_image(Options & options)
 	cv::Mat output_image;
 	if (options.keep_annotated_images or options.use_json_output == false)
 	{
-		output_image = options.nn.annotate();
-
 		if (options.size2_is_set)
 		{
-			std::cout << "-> resizing output image from " << output_image.cols << "x" << output_image.rows << " to " << options.size2.width << "x" << options.size2.height << std::endl;
-			output_image = DarkHelp::resize_keeping_aspect_ratio(output_image, options.size2);
+			// annotate directly at the output size instead of annotating at full size and then resizing
+			const cv::Size output_size = DarkHelp::size_keeping_aspect_ratio(options.nn.original_image.size(), options.size2);
+			std::cout << "-> resizing output image from " << options.nn.original_image.cols << "x" << options.nn.original_image.rows << " to " << output_size.width << "x" << output_size.height << std::endl;
+			options.nn.annotate(output_image, output_size);
+		}
+		else
+		{
+			output_image = options.nn.annotate();
 		}
 
 		if (options.keep_annotated_images)